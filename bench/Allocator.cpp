@@ -0,0 +1,31 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include "../src/tree/AVL.hpp"
+
+template <typename Tree>
+double Churn(const std::vector<int>& keys, int rounds) {
+    auto start = std::chrono::steady_clock::now();
+    Tree tree;
+    for (int r = 0; r < rounds; r++) {
+        for (int k : keys) tree.Insert(k);
+        for (int i = 0; i < (int)keys.size(); i += 2) tree.Remove(keys[i]);
+        tree.Clear();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+    std::mt19937 rng(42);
+    std::vector<int> keys(n);
+    for (int& k : keys) k = rng();
+
+    std::cout << "n = " << n << ", rounds = " << rounds << "\n";
+    std::cout << "HeapAllocator: " << Churn<AVL_Tree<int, std::less<>, HeapAllocator>>(keys, rounds) << " ms\n";
+    std::cout << "SlabAllocator: " << Churn<AVL_Tree<int, std::less<>, SlabAllocator>>(keys, rounds) << " ms\n";
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "../src/tree/AVL.hpp"
+#include "../src/tree/BPlusTree.hpp"
+#include "../src/collections/PriorityQueue.hpp"
+
+template <typename F>
+double Nanoseconds(F&& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+template <typename TreeType>
+void Measure(const char* name, const std::vector<int>& keys, const std::vector<int>& queries) {
+    TreeType* tree = new TreeType();
+    double insert = Nanoseconds([&]() {
+        for (int k : keys) tree->Insert(k);
+    });
+    long long found = 0;
+    double lookup = Nanoseconds([&]() {
+        for (int q : queries) found += tree->Contains(q);
+    });
+    long long sum = 0;
+    double scan = Nanoseconds([&]() {
+        for (int k : *tree) sum += k;
+    });
+    double remove = Nanoseconds([&]() {
+        for (std::size_t i = 0; i < keys.size(); i += 2) tree->Remove(keys[i]);
+    });
+
+    std::cout << "  " << name << ": insert " << insert / keys.size() << " ns, lookup " << lookup / queries.size()
+              << " ns, scan " << scan / keys.size() << " ns, remove " << remove / (keys.size() / 2) << " ns ("
+              << found << " hits, sum " << sum << ")\n";
+    delete tree;
+}
+
+// Очередь: все элементы кладутся со случайными приоритетами и снимаются Pop по одному.
+template <typename QueueType>
+void MeasureQueue(const char* name, const std::vector<int>& priorities) {
+    QueueType queue;
+    double push = Nanoseconds([&]() {
+        for (std::size_t i = 0; i < priorities.size(); i++) queue.Push((int)i, priorities[i]);
+    });
+    long long sum = 0;
+    double pop = Nanoseconds([&]() {
+        while (!queue.IsEmpty()) sum += queue.Pop();
+    });
+
+    std::cout << "  " << name << ": push " << push / priorities.size() << " ns, pop " << pop / priorities.size()
+              << " ns (sum " << sum << ")\n";
+}
+
+// Размеры задаются аргументами, например: ./bench/BPlusTree 100000 1000000 10000000.
+int main(int argc, char** argv) {
+    std::vector<long long> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(std::atoll(argv[i]));
+    if (sizes.empty()) sizes = {100000, 1000000, 10000000};
+
+    for (long long n : sizes) {
+        std::mt19937 rng(15);
+        std::vector<int> keys(n);
+        for (long long i = 0; i < n; i++) keys[i] = (int)(i * 2);
+        std::shuffle(keys.begin(), keys.end(), rng);
+        std::vector<int> queries(1000000);
+        for (int& q : queries) q = (int)(rng() % (2 * n));
+
+        std::cout << "n = " << n << "\n";
+        Measure<AVL_Tree<int>>("AVL_Tree<int>       ", keys, queries);
+        Measure<BPlusTree<int, 128>>("BPlusTree<int, 128> ", keys, queries);
+        Measure<BPlusTree<int, 256>>("BPlusTree<int, 256> ", keys, queries);
+        Measure<BPlusTree<int, 512>>("BPlusTree<int, 512> ", keys, queries);
+        MeasureQueue<PriorityQueue<int>>("PriorityQueue<int>            ", queries);
+        MeasureQueue<BPlusPriorityQueue<int, 256>>("BPlusPriorityQueue<int, 256>  ", queries);
+    }
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <malloc.h>
+#include "../src/tree/AVL.hpp"
+#include "../src/tree/CompactAVL.hpp"
+
+// Память считается по счётчикам glibc: байты в занятых блоках кучи плюс mmap-блоки.
+static std::size_t HeapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+template <typename TreeType>
+void Measure(const char* name, const std::vector<int>& keys, const std::vector<int>& queries) {
+    std::size_t before = HeapInUse();
+    TreeType* tree = new TreeType();
+    for (int k : keys) tree->Insert(k);
+    if constexpr (requires { tree->ShrinkToFit(); }) tree->ShrinkToFit();
+    std::size_t bytes = HeapInUse() - before;
+
+    long long found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int q : queries) found += tree->Contains(q);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "  " << name << ": " << (double)bytes / keys.size() << " bytes/element, "
+              << elapsed.count() / queries.size() << " ns/lookup (" << found << " hits)\n";
+    delete tree;
+}
+
+// Размеры задаются аргументами, например: ./bench/CompactNodes 1000000 10000000 100000000.
+// При 100M ключей AVL_Tree<int> занимает около 5 ГБ.
+int main(int argc, char** argv) {
+    std::vector<long long> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(std::atoll(argv[i]));
+    if (sizes.empty()) sizes = {1000000, 10000000};
+
+    for (long long n : sizes) {
+        std::mt19937 rng(11);
+        std::vector<int> keys(n);
+        for (long long i = 0; i < n; i++) keys[i] = (int)(i * 2);
+        std::shuffle(keys.begin(), keys.end(), rng);
+        std::vector<int> queries(1000000);
+        for (int& q : queries) q = (int)(rng() % (2 * n));
+
+        std::cout << "n = " << n << "\n";
+        Measure<AVL_Tree<int>>("AVL_Tree<int>       ", keys, queries);
+        Measure<CompactAVL_Tree<int>>("CompactAVL_Tree<int>", keys, queries);
+    }
+}
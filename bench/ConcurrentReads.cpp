@@ -0,0 +1,85 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/ConcurrentSet.hpp"
+
+// Множество под одним мьютексом - то, чем пользовались до ConcurrentSet.
+class LockedSet {
+    public:
+        bool Contains(int value) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return set.Contains(value);
+        }
+        void Insert(int value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            set.Insert(value);
+        }
+        bool Erase(int value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return set.Erase(value);
+        }
+
+    private:
+        Set<int> set;
+        mutable std::mutex mutex;
+};
+
+// Каждый поток в течение duration выполняет поиски, и одна операция из writeEvery - запись.
+// Возвращает миллионы операций в секунду на все потоки.
+template <typename SetType>
+double Throughput(SetType& set, int n, int threads, int writeEvery, std::chrono::milliseconds duration) {
+    std::atomic<bool> stop(false);
+    std::atomic<long long> total(0);
+    std::atomic<long long> found(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&set, &stop, &total, &found, n, t, writeEvery]() {
+            std::mt19937 rng(t + 1);
+            long long ops = 0, hits = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                int key = (int)(rng() % (2u * n));
+                if (writeEvery && ops % writeEvery == 0) {
+                    if (!set.Erase(key)) set.Insert(key);
+                } else {
+                    hits += set.Contains(key);
+                }
+                ops++;
+            }
+            total.fetch_add(ops, std::memory_order_relaxed);
+            found.fetch_add(hits, std::memory_order_relaxed);
+        });
+    }
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (std::thread& worker : workers) worker.join();
+    return total.load() / (duration.count() * 1000.0);
+}
+
+// Аргументы: размер множества и доля записей (одна на writeEvery операций, 0 - только чтение),
+// например ./bench/ConcurrentReads 1000000 100. На машине с одним ядром потоки делят его
+// и роста не будет: имеет смысл запускать, когда ядер не меньше, чем потоков.
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int writeEvery = argc > 2 ? std::atoi(argv[2]) : 100;
+    std::chrono::milliseconds duration(500);
+
+    LockedSet locked;
+    ConcurrentSet<int> concurrent;
+    std::vector<int> keys;
+    for (int i = 0; i < n; i++) keys.push_back(2 * i);
+    for (int k : keys) locked.Insert(k);
+    concurrent.InsertMany(keys);
+
+    std::cout << "n = " << n << ", cores = " << std::thread::hardware_concurrency()
+              << ", write every " << writeEvery << " ops, Mops/s\n";
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        double a = Throughput(locked, n, threads, writeEvery, duration);
+        double b = Throughput(concurrent, n, threads, writeEvery, duration);
+        std::cout << "  threads = " << threads << ": mutex + Set " << a << ", ConcurrentSet " << b << "\n";
+    }
+}
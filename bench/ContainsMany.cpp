@@ -0,0 +1,52 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <span>
+#include "../src/collections/Set.hpp"
+
+template <typename F>
+void Measure(const char* name, std::size_t queries, F&& run) {
+    auto start = std::chrono::steady_clock::now();
+    long long found = run();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() / queries << " ns/lookup (" << found << " hits)\n";
+}
+
+// Размеры задаются аргументами, например: ./bench/ContainsMany 100000 1000000 10000000.
+int main(int argc, char** argv) {
+    std::vector<long long> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(std::atoll(argv[i]));
+    if (sizes.empty()) sizes = {100000, 1000000, 10000000};
+
+    for (long long n : sizes) {
+        std::mt19937 rng(17);
+        std::vector<int> keys(n);
+        for (long long i = 0; i < n; i++) keys[i] = (int)(i * 2);
+        std::shuffle(keys.begin(), keys.end(), rng);
+        std::vector<int> queries(2000000);
+        for (int& q : queries) q = (int)(rng() % (2 * n));
+
+        Set<int> set;
+        for (int k : keys) set.Insert(k);
+        std::unique_ptr<bool[]> result(new bool[queries.size()]);
+
+        std::cout << "n = " << n << "\n";
+        Measure("Contains    ", queries.size(), [&]() {
+            long long found = 0;
+            for (int q : queries) found += set.Contains(q);
+            return found;
+        });
+        Measure("ContainsMany", queries.size(), [&]() {
+            set.ContainsMany(queries, std::span<bool>(result.get(), queries.size()));
+            return (long long)std::count(result.get(), result.get() + queries.size(), true);
+        });
+        Measure("FindMany    ", queries.size(), [&]() {
+            std::vector<Set<int>::const_iterator> found = std::as_const(set).FindMany(queries);
+            return (long long)std::count_if(found.begin(), found.end(), [&set](const auto& it) {return it != set.cend();});
+        });
+    }
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <span>
+#include "../src/collections/Set.hpp"
+#include "../src/tree/FrozenSet.hpp"
+
+template <typename F>
+void Measure(const char* name, std::size_t queries, F&& run) {
+    auto start = std::chrono::steady_clock::now();
+    long long found = run();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() / queries << " ns/lookup (" << found << " hits)\n";
+}
+
+// Размеры задаются аргументами, например: ./bench/FrozenSet 1000 1000000 10000000.
+int main(int argc, char** argv) {
+    std::vector<long long> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(std::atoll(argv[i]));
+    if (sizes.empty()) sizes = {1000, 1000000, 10000000};
+
+    for (long long n : sizes) {
+        std::mt19937 rng(14);
+        std::vector<int> keys(n);
+        for (long long i = 0; i < n; i++) keys[i] = (int)(i * 2);
+        std::vector<int> queries(4000000);
+        for (int& q : queries) q = (int)(rng() % (2 * n));
+
+        Set<int>* set = Set<int>::FromSorted(keys);
+        FrozenSet<int>* frozen = set->Freeze();
+        std::unique_ptr<bool[]> result(new bool[queries.size()]);
+
+        std::cout << "n = " << n << "\n";
+        Measure("Set::Contains             ", queries.size(), [&]() {
+            long long found = 0;
+            for (int q : queries) found += set->Contains(q);
+            return found;
+        });
+        Measure("FrozenSet::Contains       ", queries.size(), [&]() {
+            long long found = 0;
+            for (int q : queries) found += frozen->Contains(q);
+            return found;
+        });
+        Measure("FrozenSet::ContainsMany   ", queries.size(), [&]() {
+            frozen->ContainsMany(queries, std::span<bool>(result.get(), queries.size()));
+            return (long long)std::count(result.get(), result.get() + queries.size(), true);
+        });
+        delete frozen;
+        delete set;
+    }
+}
@@ -0,0 +1,66 @@
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/Set.hpp"
+#include "../src/collections/PriorityQueue.hpp"
+
+// Все выделения памяти в программе проходят через этот счётчик.
+static long long allocations = 0;
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+template <typename F>
+double Elapsed(F&& action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Вставляет n ключей функцией insert(i) в новый контейнер и печатает выделения и время на ключ.
+// Строки длиннее буфера короткой строки, так что каждая копия ключа - это выделение.
+template <typename Container, typename F>
+void Measure(const char* name, int n, F&& insert) {
+    Container container;
+    long long before = allocations;
+    double ns = Elapsed([&] {
+        for (int i = 0; i < n; i++) insert(container, i);
+    });
+    std::cout << "  " << name << (double)(allocations - before) / n << " allocations, " << ns / n << " ns per insert\n";
+}
+
+// Аргумент - число ключей, например ./bench/InsertAllocations 200000.
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 200000;
+    std::mt19937 rng(23);
+    std::vector<std::string> keys(n);
+    for (std::string& key : keys) key = "key-with-a-long-prefix-" + std::to_string(rng());
+    // Копии для перемещения готовятся заранее, чтобы их выделения не попали в замер.
+    std::vector<std::string> moved = keys;
+    std::vector<std::string> movedAgain = keys;
+
+    std::cout << "n = " << n << ", std::string keys of " << keys[0].size() << "+ chars\n";
+    Measure<Set<std::string>>("Set::Insert(const T&)     ", n, [&](auto& set, int i) {set.Insert(keys[i]);});
+    Measure<Set<std::string>>("Set::Insert(T&&)          ", n, [&](auto& set, int i) {set.Insert(std::move(moved[i]));});
+    Measure<Set<std::string>>("Set::Emplace(const char*) ", n, [&](auto& set, int i) {set.Emplace(keys[i].c_str());});
+    Measure<std::set<std::string>>("std::set::insert(const T&) ", n, [&](auto& set, int i) {set.insert(keys[i]);});
+    Measure<PriorityQueue<std::string>>("PQ::Push(const T&, int)   ", n, [&](auto& queue, int i) {queue.Push(keys[i], i);});
+    Measure<PriorityQueue<std::string>>("PQ::Push(T&&, int)        ", n, [&](auto& queue, int i) {queue.Push(std::move(movedAgain[i]), i);});
+}
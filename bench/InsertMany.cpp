@@ -0,0 +1,44 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/Set.hpp"
+
+// Время вставки total новых ключей пачками по batch штук в множество из base элементов, нс на ключ.
+template <typename F>
+double Measure(const Set<int>& base, const std::vector<int>& keys, int batch, F&& insert) {
+    Set<int> set(base);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < keys.size(); i += batch) {
+        std::size_t end = std::min(keys.size(), i + batch);
+        insert(set, std::vector<int>(keys.begin() + i, keys.begin() + end));
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / keys.size();
+}
+
+// Аргументы: размер исходного множества и число вставляемых ключей, например ./bench/InsertMany 1000000 1000000.
+int main(int argc, char** argv) {
+    int base = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int total = argc > 2 ? std::atoi(argv[2]) : 1000000;
+
+    std::mt19937 rng(16);
+    std::vector<int> initial(base);
+    for (int& k : initial) k = (int)(rng() % (4u * (base + total)));
+    std::vector<int> keys(total);
+    for (int& k : keys) k = (int)(rng() % (4u * (base + total)));
+    Set<int> set;
+    set.InsertMany(initial);
+
+    std::cout << "base = " << set.Size() << ", inserted keys = " << total << "\n";
+    for (int batch = 10; batch <= total; batch *= 10) {
+        double loop = Measure(set, keys, batch, [](Set<int>& s, const std::vector<int>& values) {
+            for (int v : values) s.Insert(v);
+        });
+        double many = Measure(set, keys, batch, [](Set<int>& s, const std::vector<int>& values) {
+            s.InsertMany(values);
+        });
+        std::cout << "  batch " << batch << ": Insert " << loop << " ns/key, InsertMany " << many << " ns/key\n";
+    }
+}
@@ -0,0 +1,43 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/Set.hpp"
+
+template <typename Container>
+double SumAll(const Container& container, int rounds, long long& sum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const int& value : container) {
+            sum += value;
+        }
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 10;
+    std::mt19937 rng(3);
+    std::vector<int> keys(n);
+    for (int& k : keys) k = rng();
+
+    Set<int> set;
+    Set<int, std::less<>, SlabAllocator> slabSet;
+    std::set<int> stdSet;
+    for (int k : keys) {
+        set.Insert(k);
+        slabSet.Insert(k);
+        stdSet.insert(k);
+    }
+
+    long long sum = 0;
+    std::cout << "n = " << set.Size() << ", range-for per pass:\n";
+    std::cout << "Set<int>:                " << SumAll(set, rounds, sum) << " ms\n";
+    std::cout << "Set<int, SlabAllocator>: " << SumAll(slabSet, rounds, sum) << " ms\n";
+    std::cout << "std::set<int>:           " << SumAll(stdSet, rounds, sum) << " ms\n";
+    std::cout << "(checksum " << sum << ")\n";
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include "../src/tree/AVL.hpp"
+
+template <typename F>
+double Elapsed(F&& action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+struct Result {
+    double removeNs;
+    double lookupNs;
+    double insertNs;
+    long long found;
+};
+
+// Циклы: удаление burst ключей, поиск по всему набору, возврат удалённых ключей.
+// fraction = 0 - обычное удаление, иначе ленивое с уплотнением при этой доле мёртвых узлов.
+// Время удаления включает уплотнения, то есть это амортизированная цена.
+Result Run(const std::vector<int>& keys, int burst, int rounds, double fraction) {
+    AVL_Tree<int> tree;
+    for (int k : keys) tree.Insert(k);
+    tree.SetLazyRemove(fraction);
+    std::mt19937 rng(22);
+    Result result{0, 0, 0, 0};
+    std::vector<int> removed(burst);
+    std::vector<int> probes(keys.size());
+    for (int round = 0; round < rounds; round++) {
+        for (int& k : removed) k = keys[rng() % keys.size()];
+        for (int& k : probes) k = keys[rng() % keys.size()];
+        result.removeNs += Elapsed([&] {
+            for (int k : removed) tree.Remove(k);
+        });
+        result.lookupNs += Elapsed([&] {
+            for (int k : probes) result.found += tree.Contains(k);
+        });
+        result.insertNs += Elapsed([&] {
+            for (int k : removed) tree.Insert(k);
+        });
+    }
+    result.removeNs /= (double)burst * rounds;
+    result.lookupNs /= (double)probes.size() * rounds;
+    result.insertNs /= (double)burst * rounds;
+    return result;
+}
+
+// Аргументы - размер дерева и число удалений за цикл, например ./bench/LazyRemove 1000000 100000.
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int burst = argc > 2 ? std::atoi(argv[2]) : n / 10;
+    int rounds = 5;
+    std::mt19937 rng(22);
+    std::vector<int> keys(n);
+    for (int& k : keys) k = (int)rng();
+
+    std::cout << "n = " << n << ", " << burst << " removals per round, ns/op\n";
+    std::cout << "  mode          remove   contains  reinsert\n";
+    for (double fraction : {0.0, 0.1, 0.25, 0.5}) {
+        Result r = Run(keys, burst, rounds, fraction);
+        std::cout << "  " << (fraction == 0 ? std::string("eager ") : "lazy " + std::to_string(fraction).substr(0, 4))
+                  << "    " << r.removeNs << "    " << r.lookupNs << "    " << r.insertNs
+                  << (r.found < 0 ? "!" : "") << "\n";
+    }
+}
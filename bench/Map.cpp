@@ -0,0 +1,88 @@
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/Map.hpp"
+
+template <typename F>
+double Elapsed(F&& action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+enum class Op {Read, Update, Upsert, Erase};
+
+// Смесь операций: доля чтений reads процентов, остальное поровну между
+// обновлением существующего ключа (operator[]), вставкой-или-заменой и удалением.
+std::vector<Op> Mix(int n, int reads, std::mt19937& rng) {
+    std::vector<Op> ops(n);
+    for (Op& op : ops) {
+        int r = (int)(rng() % 100);
+        if (r < reads) op = Op::Read;
+        else op = (Op)(1 + r % 3);
+    }
+    return ops;
+}
+
+// Операции ко всем словарям идут через одинаковые обёртки, нс на операцию.
+template <typename MapType, typename Key, typename ReadF, typename UpdateF, typename UpsertF, typename EraseF>
+double Run(const std::vector<Key>& keys, const std::vector<Op>& ops, const std::vector<int>& picks,
+           ReadF&& read, UpdateF&& update, UpsertF&& upsert, EraseF&& erase) {
+    MapType map;
+    for (std::size_t i = 0; i < keys.size(); i += 2) upsert(map, keys[i], (int)i);
+    long long sum = 0;
+    double ns = Elapsed([&] {
+        for (std::size_t i = 0; i < ops.size(); i++) {
+            const Key& key = keys[picks[i]];
+            switch (ops[i]) {
+                case Op::Read: sum += read(map, key); break;
+                case Op::Update: update(map, key); break;
+                case Op::Upsert: upsert(map, key, (int)i); break;
+                case Op::Erase: erase(map, key); break;
+            }
+        }
+    });
+    if (sum == -1) std::cout << "";
+    return ns / ops.size();
+}
+
+template <typename Key>
+void Compare(const char* title, const std::vector<Key>& keys, int operations, std::mt19937& rng) {
+    std::vector<int> picks(operations);
+    for (int& p : picks) p = (int)(rng() % keys.size());
+    std::cout << title << "\n  reads    Map      std::map   ns/op\n";
+    for (int reads : {95, 75, 50}) {
+        std::vector<Op> ops = Mix(operations, reads, rng);
+        double ours = Run<Map<Key, int>>(keys, ops, picks,
+            [](auto& m, const Key& k) {auto it = m.Find(k); return it == m.end() ? 0 : it->value;},
+            [](auto& m, const Key& k) {m[k]++;},
+            [](auto& m, const Key& k, int v) {m.InsertOrAssign(k, v);},
+            [](auto& m, const Key& k) {m.Erase(k);});
+        double theirs = Run<std::map<Key, int>>(keys, ops, picks,
+            [](auto& m, const Key& k) {auto it = m.find(k); return it == m.end() ? 0 : it->second;},
+            [](auto& m, const Key& k) {m[k]++;},
+            [](auto& m, const Key& k, int v) {m.insert_or_assign(k, v);},
+            [](auto& m, const Key& k) {m.erase(k);});
+        std::cout << "  " << reads << "%      " << ours << "    " << theirs << "\n";
+    }
+}
+
+// Аргументы - число ключей и число операций, например ./bench/Map 1000000 2000000.
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int operations = argc > 2 ? std::atoi(argv[2]) : 2000000;
+    std::mt19937 rng(25);
+    std::vector<int> ints(n);
+    for (int& k : ints) k = (int)rng();
+    std::vector<std::string> strings(n);
+    for (std::string& k : strings) k = "user:" + std::to_string(rng()) + ":session";
+
+    std::cout << n << " keys (half present at start), " << operations << " operations\n";
+    Compare("int keys", ints, operations, rng);
+    Compare("std::string keys", strings, operations, rng);
+}
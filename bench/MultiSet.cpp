@@ -0,0 +1,52 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/MultiSet.hpp"
+
+template <typename F>
+double Elapsed(F&& action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// n вставок из distinct различных ключей, затем n поисков и n удалений по одному вхождению, нс на операцию.
+template <typename Container, typename InsertF, typename ContainsF, typename RemoveF>
+void Measure(const char* name, const std::vector<int>& keys, InsertF&& insert, ContainsF&& contains, RemoveF&& remove) {
+    Container container;
+    long long found = 0;
+    double insertNs = Elapsed([&] {
+        for (int k : keys) insert(container, k);
+    });
+    double containsNs = Elapsed([&] {
+        for (int k : keys) found += contains(container, k);
+    });
+    double removeNs = Elapsed([&] {
+        for (int k : keys) remove(container, k);
+    });
+    double n = (double)keys.size();
+    std::cout << "  " << name << insertNs / n << "    " << containsNs / n << "    " << removeNs / n
+              << (found < 0 ? "!" : "") << "\n";
+}
+
+// Аргументы - число вставок и число различных ключей, например ./bench/MultiSet 1000000 16.
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int distinct = argc > 2 ? std::atoi(argv[2]) : 16;
+    std::mt19937 rng(24);
+    std::vector<int> keys(n);
+    for (int& k : keys) k = (int)(rng() % distinct);
+
+    std::cout << "n = " << n << ", " << distinct << " distinct keys, ns/op\n";
+    std::cout << "                           insert  contains  remove one\n";
+    Measure<MultiSet<int>>("MultiSet (counted)       ", keys,
+        [](auto& s, int k) {s.Insert(k);}, [](auto& s, int k) {return s.Contains(k);}, [](auto& s, int k) {s.RemoveOne(k);});
+    Measure<AVL_Tree<int>>("AVL_Tree (node per copy) ", keys,
+        [](auto& s, int k) {s.Insert(k);}, [](auto& s, int k) {return s.Contains(k);}, [](auto& s, int k) {s.Remove(k);});
+    Measure<std::multiset<int>>("std::multiset            ", keys,
+        [](auto& s, int k) {s.insert(k);}, [](auto& s, int k) {return s.count(k) > 0;}, [](auto& s, int k) {s.erase(s.find(k));});
+}
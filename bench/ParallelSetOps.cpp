@@ -0,0 +1,47 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include "../src/collections/Set.hpp"
+
+using SlabSet = Set<int64_t, std::less<>, SlabAllocator>;
+
+template <typename F>
+double Measure(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    if (maxThreads < 1) maxThreads = 1;
+
+    std::mt19937_64 rng(7);
+    std::vector<int64_t> left(n), right(n);
+    for (int64_t& k : left) k = rng() % (4LL * n);
+    for (int64_t& k : right) k = rng() % (4LL * n);
+    std::sort(left.begin(), left.end());
+    std::sort(right.begin(), right.end());
+    SlabSet* A = SlabSet::FromSorted(left);
+    SlabSet* B = SlabSet::FromSorted(right);
+    std::cout << "|A| = " << A->Size() << ", |B| = " << B->Size() << "\n";
+
+    std::cout << "sequential: union " << Measure([&]() {delete SlabSet::Union(A, B);})
+              << " ms, intersection " << Measure([&]() {delete SlabSet::Intersection(A, B);})
+              << " ms, difference " << Measure([&]() {delete SlabSet::Difference(A, B);}) << " ms\n";
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        ForkJoinPool pool(threads);
+        std::cout << threads << " threads: union " << Measure([&]() {delete SlabSet::Union(A, B, pool);})
+                  << " ms, intersection " << Measure([&]() {delete SlabSet::Intersection(A, B, pool);})
+                  << " ms, difference " << Measure([&]() {delete SlabSet::Difference(A, B, pool);}) << " ms\n";
+    }
+
+    delete A;
+    delete B;
+}
@@ -0,0 +1,44 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/Set.hpp"
+
+template <typename F>
+double Milliseconds(F&& action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Аргументы: размер множества и наибольшее число потоков, например ./bench/ParallelTraversal 50000000 20.
+// Результаты Where и Map строятся в вызывающем потоке, поэтому их время ограничено построением дерева.
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 5000000;
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 8;
+    std::vector<long long> keys(n);
+    for (int i = 0; i < n; i++) keys[i] = i;
+    Set<long long>* set = Set<long long>::FromSorted(keys);
+
+    auto odd = [](long long x) {return (x & 1) == 1;};
+    auto scale = [](long long x) {return x * 3;};
+    auto sum = [](long long a, long long b) {return a + b;};
+    long long check = 0;
+
+    std::cout << "n = " << n << ", ms (Where / Map / Reduce)\n";
+    double where = Milliseconds([&] {delete set->Where(odd);});
+    double map = Milliseconds([&] {delete set->Map<long long>(scale);});
+    double reduce = Milliseconds([&] {set->InOrder([&check](long long x) {check += x;});});
+    std::cout << "  sequential: " << where << " / " << map << " / " << reduce << "\n";
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        ForkJoinPool pool(threads);
+        where = Milliseconds([&] {delete set->Where(odd, pool);});
+        map = Milliseconds([&] {delete set->Map<long long>(scale, pool);});
+        reduce = Milliseconds([&] {check += set->Reduce(sum, 0, pool);});
+        std::cout << "  threads = " << threads << ": " << where << " / " << map << " / " << reduce << "\n";
+    }
+    std::cout << "  checksum " << check << "\n";
+    delete set;
+}
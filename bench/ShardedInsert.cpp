@@ -0,0 +1,65 @@
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/Set.hpp"
+#include "../src/collections/ShardedSet.hpp"
+
+// Одно множество под одним мьютексом - исходный вариант.
+class LockedSet {
+    public:
+        bool Insert(int value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return set.Insert(value);
+        }
+
+    private:
+        Set<int> set;
+        std::mutex mutex;
+};
+
+// total случайных ключей делятся поровну между threads потоками; результат - миллионы вставок в секунду.
+template <typename SetType>
+double Throughput(SetType& set, const std::vector<int>& keys, int threads) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    std::size_t chunk = (keys.size() + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&set, &keys, t, chunk]() {
+            std::size_t end = std::min(keys.size(), (t + 1) * chunk);
+            for (std::size_t i = t * chunk; i < end; i++) set.Insert(keys[i]);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return keys.size() / elapsed.count();
+}
+
+// Аргументы: число ключей и число шардов, например ./bench/ShardedInsert 2000000 64.
+// На машине с одним ядром потоки делят его и роста не будет.
+int main(int argc, char** argv) {
+    int total = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    int shards = argc > 2 ? std::atoi(argv[2]) : 64;
+    std::mt19937 rng(20);
+    std::vector<int> keys(total);
+    for (int& k : keys) k = (int)rng();
+
+    std::cout << "keys = " << total << ", shards = " << shards << ", cores = "
+              << std::thread::hardware_concurrency() << ", Minserts/s\n";
+    // Возрастающие ключи (время, идентификаторы) все попадают в последний шард.
+    std::vector<int> ascending(total);
+    for (int i = 0; i < total; i++) ascending[i] = i;
+    for (const auto& [name, order] : {std::pair{"random", &keys}, std::pair{"ascending", &ascending}}) {
+        std::cout << name << " keys\n";
+        for (int threads = 1; threads <= 64; threads *= 2) {
+            LockedSet locked;
+            ShardedSet<int> sharded(shards);
+            double a = Throughput(locked, *order, threads);
+            double b = Throughput(sharded, *order, threads);
+            std::cout << "  threads = " << threads << ": mutex + Set " << a << ", ShardedSet " << b << "\n";
+        }
+    }
+}
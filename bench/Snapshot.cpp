@@ -0,0 +1,65 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include "../src/collections/Set.hpp"
+
+template <typename F>
+double Elapsed(F&& action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Вставка keys с версией, снимаемой каждые every вставок (0 - без снимков), нс на ключ.
+template <typename SetType>
+double InsertWithSnapshots(const std::vector<int>& keys, int every) {
+    SetType set;
+    std::vector<SetType*> versions;
+    double ns = Elapsed([&] {
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            set.Insert(keys[i]);
+            if (every && i % every == 0) versions.push_back(new SetType(set));
+        }
+    });
+    for (SetType* version : versions) delete version;
+    return ns / keys.size();
+}
+
+// Аргумент - размер множества, например ./bench/Snapshot 1000000.
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    std::mt19937 rng(18);
+    std::vector<int> keys(n);
+    for (int& k : keys) k = (int)rng();
+
+    Set<int> set;
+    PersistentSet<int> persistent;
+    for (int k : keys) {
+        set.Insert(k);
+        persistent.Insert(k);
+    }
+
+    Set<int>* copy = nullptr;
+    PersistentSet<int>* snapshot = nullptr;
+    double copyNs = Elapsed([&] {copy = new Set<int>(set);});
+    double snapshotNs = Elapsed([&] {snapshot = persistent.Snapshot();});
+    std::cout << "n = " << n << "\n";
+    std::cout << "  Set copy:                 " << copyNs / 1e6 << " ms\n";
+    std::cout << "  PersistentSet::Snapshot:  " << snapshotNs << " ns\n";
+
+    // Изменения после снимка копируют только пути и не видны в снимке.
+    double writeNs = Elapsed([&] {
+        for (int i = 0; i < 100000; i++) persistent.Erase(keys[i]);
+    });
+    std::cout << "  Erase after snapshot:     " << writeNs / 100000 << " ns/key (snapshot keeps "
+              << snapshot->Size() << ", writer has " << persistent.Size() << ")\n";
+    delete copy;
+    delete snapshot;
+
+    std::cout << "  Insert, Set:              " << InsertWithSnapshots<Set<int>>(keys, 0) << " ns/key\n";
+    std::cout << "  Insert, PersistentSet:    " << InsertWithSnapshots<PersistentSet<int>>(keys, 0) << " ns/key\n";
+    std::cout << "  Insert, snapshot per 100: " << InsertWithSnapshots<PersistentSet<int>>(keys, 100) << " ns/key\n";
+}
@@ -0,0 +1,136 @@
+#ifndef CONCURRENTSET_HPP
+#define CONCURRENTSET_HPP
+
+#include <atomic>
+#include <mutex>
+#include <span>
+#include "Set.hpp"
+#include "../parallel/EpochDomain.hpp"
+
+// Множество для нагрузки, где чтений гораздо больше, чем записей. Читатели не берут
+// блокировок: они закрепляются в эпохе и работают с последней опубликованной версией.
+// Писатели по очереди меняют собственную рабочую копию (PersistentSet копирует только
+// изменённые пути) и атомарно публикуют её снимок; прежняя версия освобождается через
+// EpochDomain, когда её уже не может читать ни один поток.
+template <typename T, typename Compare = std::less<>>
+class ConcurrentSet {
+    public:
+        using Version = PersistentSet<T, Compare>;
+
+        ConcurrentSet() : current(new Version()) {}
+
+        ConcurrentSet(const ConcurrentSet&) = delete;
+        ConcurrentSet& operator=(const ConcurrentSet&) = delete;
+
+        // Чтение
+
+        bool Contains(const T& value) const {
+            auto guard = EpochDomain::Global().Pin();
+            return Load()->Contains(value);
+        }
+
+        template <typename K> requires IsTransparentCompare<Compare>
+        bool Contains(const K& value) const {
+            auto guard = EpochDomain::Global().Pin();
+            return Load()->Contains(value);
+        }
+
+        void ContainsMany(std::span<const T> values, std::span<bool> out) const {
+            auto guard = EpochDomain::Global().Pin();
+            Load()->ContainsMany(values, out);
+        }
+
+        int Size() const {
+            auto guard = EpochDomain::Global().Pin();
+            return Load()->Size();
+        }
+
+        bool IsEmpty() const {
+            return Size() == 0;
+        }
+
+        // Все обходы одного вызова видят одну и ту же версию.
+        template <typename F>
+        void ForEachInRange(const T& lo, const T& hi, F&& visit) const {
+            auto guard = EpochDomain::Global().Pin();
+            Load()->ForEachInRange(lo, hi, std::forward<F>(visit));
+        }
+
+        template <typename F>
+        bool InOrder(F&& visit) const {
+            auto guard = EpochDomain::Global().Pin();
+            return Load()->InOrder(std::forward<F>(visit));
+        }
+
+        // Вызывает f с текущей версией; ссылку на неё нельзя сохранять после возврата.
+        template <typename F>
+        decltype(auto) Read(F&& f) const {
+            auto guard = EpochDomain::Global().Pin();
+            return f(*Load());
+        }
+
+        // Версия, которая остаётся доступной и после новых записей, за O(1).
+        Version* Snapshot() const {
+            auto guard = EpochDomain::Global().Pin();
+            return Load()->Snapshot();
+        }
+
+        // Запись. Каждая операция публикует новую версию; Update позволяет
+        // сделать несколько изменений за одну публикацию.
+
+        bool Insert(const T& value) {
+            std::lock_guard<std::mutex> lock(writer);
+            if (!working.Insert(value)) return false;
+            Publish();
+            return true;
+        }
+
+        template <typename Range>
+        void InsertMany(const Range& range) {
+            std::lock_guard<std::mutex> lock(writer);
+            working.InsertMany(range);
+            Publish();
+        }
+
+        bool Erase(const T& value) {
+            std::lock_guard<std::mutex> lock(writer);
+            if (!working.Erase(value)) return false;
+            Publish();
+            return true;
+        }
+
+        template <typename F>
+        void Update(F&& change) {
+            std::lock_guard<std::mutex> lock(writer);
+            change(working);
+            Publish();
+        }
+
+        void Clear() {
+            std::lock_guard<std::mutex> lock(writer);
+            working.Clear();
+            Publish();
+        }
+
+        // Читателей к этому моменту быть не должно; снятые раньше версии
+        // освобождаются доменом независимо от множества.
+        ~ConcurrentSet() {
+            delete current.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<Version*> current;
+        Version working;
+        std::mutex writer;
+
+        const Version* Load() const {
+            return current.load(std::memory_order_acquire);
+        }
+
+        void Publish() {
+            Version* previous = current.exchange(working.Snapshot(), std::memory_order_acq_rel);
+            EpochDomain::Global().Retire(previous);
+        }
+};
+
+#endif // CONCURRENTSET_HPP
@@ -0,0 +1,255 @@
+#ifndef MAP_HPP
+#define MAP_HPP
+
+#include <concepts>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "../tree/AVL.hpp"
+#include "../../auxiliary/Iterator.hpp"
+
+// Метка конструктора MapEntry, строящего значение вызовом фабрики.
+struct ValueFactory {
+    explicit ValueFactory() = default;
+};
+
+// Запись словаря. Значение строится на месте из аргументов после std::in_place
+// или из результата make() после ValueFactory.
+template <typename K, typename V>
+struct MapEntry {
+    template <typename KK, typename... Args>
+    MapEntry(std::in_place_t, KK&& k, Args&&... args) : key(std::forward<KK>(k)), value(std::forward<Args>(args)...) {}
+
+    template <typename KK, typename F>
+    MapEntry(ValueFactory, KK&& k, F& make) : key(std::forward<KK>(k)), value(std::invoke(make)) {}
+
+    const K key;
+    V value;
+};
+
+// Упорядоченный словарь на AVL_Tree: записи упорядочены и ищутся только по ключу.
+// operator[], TryEmplace, InsertOrAssign и FindOrInsert находят ключ и, если его нет,
+// вставляют запись за один спуск; значение строится прямо в узле. Итераторы дают
+// записи MapEntry по возрастанию ключей; ключ записи константный, значение можно менять.
+template <typename K, typename V, typename Compare = std::less<>, template <typename> class Allocator = HeapAllocator>
+class Map : public IEnumerable<MapEntry<K, V>> {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using Entry = MapEntry<K, V>;
+        using value_type = Entry;
+        using Engine = AVL_Tree<Entry, EntryKeyCompare<Entry, Compare>, Allocator>;
+        using iterator = typename Engine::iterator;
+        using const_iterator = typename Engine::const_iterator;
+
+        iterator begin() {
+            return tree.begin();
+        }
+
+        iterator end() {
+            return tree.end();
+        }
+
+        const_iterator begin() const {
+            return tree.cbegin();
+        }
+
+        const_iterator end() const {
+            return tree.cend();
+        }
+
+        const_iterator cbegin() const {
+            return tree.cbegin();
+        }
+
+        const_iterator cend() const {
+            return tree.cend();
+        }
+
+        std::unique_ptr<IIterator<Entry, false>> GetIterator() override {
+            return tree.GetIterator();
+        }
+
+        std::unique_ptr<IIterator<Entry, true>> GetConstIterator() const override {
+            return tree.GetConstIterator();
+        }
+
+        bool operator==(const Map& other) const {
+            if (Size() != other.Size()) return false;
+            const_iterator it = other.cbegin();
+            return tree.InOrder([&it](const Entry& entry) {
+                if (Engine::CompareKeys(entry, *it) != 0 || !(entry.value == it->value)) return VisitResult::Stop;
+                ++it;
+                return VisitResult::Continue;
+            });
+        }
+        bool operator!=(const Map& other) const {
+            return !(*this == other);
+        }
+
+        int Size() const {
+            return tree.Size();
+        }
+
+        bool IsEmpty() const {
+            return Size() == 0;
+        }
+
+        // Значение по ключу; отсутствующий ключ вставляется со значением V().
+        V& operator[](const K& key) {
+            return tree.FindOrEmplace(key, std::in_place, key).first->value;
+        }
+
+        V& operator[](K&& key) {
+            return tree.FindOrEmplace(key, std::in_place, std::move(key)).first->value;
+        }
+
+        // Вставляет запись со значением из args, только если ключа нет; иначе args не трогаются.
+        template <typename... Args>
+        std::pair<iterator, bool> TryEmplace(const K& key, Args&&... args) {
+            return tree.FindOrEmplace(key, std::in_place, key, std::forward<Args>(args)...);
+        }
+
+        template <typename... Args>
+        std::pair<iterator, bool> TryEmplace(K&& key, Args&&... args) {
+            return tree.FindOrEmplace(key, std::in_place, std::move(key), std::forward<Args>(args)...);
+        }
+
+        // Вставляет запись или присваивает значение существующей; второй элемент - признак вставки.
+        template <typename M>
+        std::pair<iterator, bool> InsertOrAssign(const K& key, M&& value) {
+            auto result = tree.FindOrEmplace(key, std::in_place, key, std::forward<M>(value));
+            if (!result.second) result.first->value = std::forward<M>(value);
+            return result;
+        }
+
+        template <typename M>
+        std::pair<iterator, bool> InsertOrAssign(K&& key, M&& value) {
+            auto result = tree.FindOrEmplace(key, std::in_place, std::move(key), std::forward<M>(value));
+            if (!result.second) result.first->value = std::forward<M>(value);
+            return result;
+        }
+
+        // Значение по ключу; make() вызывается, только если ключа нет, и его результат вставляется.
+        template <typename F> requires std::invocable<F&>
+        V& FindOrInsert(const K& key, F&& make) {
+            return tree.FindOrEmplace(key, ValueFactory{}, key, make).first->value;
+        }
+
+        bool Contains(const K& key) const {
+            return tree.Contains(key);
+        }
+
+        template <typename Q> requires IsTransparentCompare<Compare>
+        bool Contains(const Q& key) const {
+            return tree.Contains(key);
+        }
+
+        iterator Find(const K& key) {
+            return tree.Find(key);
+        }
+        const_iterator Find(const K& key) const {
+            return tree.Find(key);
+        }
+
+        template <typename Q> requires IsTransparentCompare<Compare>
+        iterator Find(const Q& key) {
+            return tree.Find(key);
+        }
+        template <typename Q> requires IsTransparentCompare<Compare>
+        const_iterator Find(const Q& key) const {
+            return tree.Find(key);
+        }
+
+        V& At(const K& key) {
+            iterator it = Find(key);
+            if (it == end()) throw std::out_of_range("Key not found");
+            return it->value;
+        }
+
+        const V& At(const K& key) const {
+            const_iterator it = Find(key);
+            if (it == cend()) throw std::out_of_range("Key not found");
+            return it->value;
+        }
+
+        bool Erase(const K& key) {
+            return tree.Remove(key);
+        }
+
+        iterator LowerBound(const K& key) {
+            return tree.LowerBound(key);
+        }
+        const_iterator LowerBound(const K& key) const {
+            return tree.LowerBound(key);
+        }
+
+        iterator UpperBound(const K& key) {
+            return tree.UpperBound(key);
+        }
+        const_iterator UpperBound(const K& key) const {
+            return tree.UpperBound(key);
+        }
+
+        // Посетитель получает ключ и значение; может вернуть VisitResult::Stop.
+        template <typename F>
+        bool InOrder(F&& visit) const {
+            return tree.InOrder([&visit](const Entry& entry) {
+                return VisitEntry(visit, entry) ? VisitResult::Continue : VisitResult::Stop;
+            });
+        }
+
+        // Обходит записи с ключами из [lo, hi) по возрастанию.
+        template <typename F>
+        bool ForEachInRange(const K& lo, const K& hi, F&& visit) const {
+            for (const_iterator it = tree.LowerBound(lo); it != tree.cend() && Compare{}(it->key, hi); ++it) {
+                if (!VisitEntry(visit, *it)) return false;
+            }
+            return true;
+        }
+
+        int CountRange(const K& lo, const K& hi) const {
+            int count = Rank(hi) - Rank(lo);
+            return count > 0 ? count : 0;
+        }
+
+        // Число ключей, меньших key.
+        int Rank(const K& key) const {
+            return tree.Rank(key);
+        }
+
+        void Clear() {
+            tree.Clear();
+        }
+
+        std::string toString() const {
+            std::ostringstream oss;
+            oss << "{";
+            bool first = true;
+            tree.InOrder([&oss, &first](const Entry& entry) {
+                if (!first) oss << ", ";
+                oss << entry.key << ": " << entry.value;
+                first = false;
+            });
+            oss << "}";
+            return oss.str();
+        }
+
+    private:
+        Engine tree;
+
+        template <typename F>
+        static bool VisitEntry(F& visit, const Entry& entry) {
+            if constexpr (std::is_same_v<std::invoke_result_t<F&, const K&, const V&>, VisitResult>) {
+                return visit(entry.key, entry.value) == VisitResult::Continue;
+            } else {
+                visit(entry.key, entry.value);
+                return true;
+            }
+        }
+};
+
+#endif // MAP_HPP
@@ -0,0 +1,294 @@
+#ifndef MULTISET_HPP
+#define MULTISET_HPP
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "../tree/AVL.hpp"
+#include "../../auxiliary/Iterator.hpp"
+
+// Ключ мультимножества и число его вхождений; порядок определяется только ключом.
+template <typename T>
+struct CountedKey {
+    T key;
+    int count;
+};
+
+// Проходит каждый ключ столько раз, сколько он входит в мультимножество;
+// occurrence - номер текущего вхождения.
+template <typename T, bool IsConst>
+class MultiSetIterator : public IIterator<T, IsConst> {
+    public:
+        using value_type = typename IIterator<T, IsConst>::value_type;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = typename IIterator<T, IsConst>::reference;
+        using difference_type = typename IIterator<T, IsConst>::difference_type;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using Base = TreeIterator<CountedKey<T>, IsConst>;
+
+        MultiSetIterator(Base b, int k = 0) : current(b), occurrence(k) {}
+
+        bool HasNext() const override {
+            return current != End() && (occurrence + 1 < current->count || current.HasNext());
+        }
+
+        bool HasPrev() const {
+            return current != End() && (occurrence > 0 || current.HasPrev());
+        }
+
+        reference Current() override {
+            return operator*();
+        }
+
+        void MoveNext() override {
+            operator++();
+        }
+
+        void MovePrev() {
+            operator--();
+        }
+
+        MultiSetIterator& operator++() {
+            toNext();
+            return *this;
+        }
+
+        MultiSetIterator operator++(int) {
+            MultiSetIterator tmp = *this;
+            toNext();
+            return tmp;
+        }
+
+        MultiSetIterator& operator--() {
+            toPrev();
+            return *this;
+        }
+
+        MultiSetIterator operator--(int) {
+            MultiSetIterator tmp = *this;
+            toPrev();
+            return tmp;
+        }
+
+        reference operator*() const {
+            return current->key;
+        }
+
+        pointer operator->() const {
+            return &(operator*());
+        }
+
+        bool operator==(const MultiSetIterator& other) const {
+            return current == other.current && occurrence == other.occurrence;
+        }
+
+        bool operator!=(const MultiSetIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Base current;
+        int occurrence;
+
+        Base End() const {
+            return Base(nullptr, nullptr);
+        }
+
+        void toNext() {
+            if (occurrence + 1 < current->count) {
+                occurrence++;
+            } else {
+                ++current;
+                occurrence = 0;
+            }
+        }
+
+        void toPrev() {
+            if (current != End() && occurrence > 0) {
+                occurrence--;
+            } else {
+                --current;
+                occurrence = current->count - 1;
+            }
+        }
+};
+
+// Мультимножество, где равные ключи хранятся одним узлом со счётчиком: повторная вставка
+// ключа - это спуск и увеличение счётчика, без выделения памяти и поворотов, а высота
+// дерева зависит только от числа различных ключей.
+template <typename T, typename Compare = std::less<>, template <typename> class Allocator = HeapAllocator>
+class MultiSet : public IEnumerable<T> {
+    public:
+        using value_type = T;
+        using Entry = CountedKey<T>;
+        using Engine = AVL_Tree<Entry, EntryKeyCompare<Entry, Compare>, Allocator>;
+        using iterator = MultiSetIterator<T, false>;
+        using const_iterator = MultiSetIterator<T, true>;
+
+        iterator begin() {
+            return iterator(tree.begin());
+        }
+
+        iterator end() {
+            return iterator(tree.end());
+        }
+
+        const_iterator begin() const {
+            return const_iterator(tree.cbegin());
+        }
+
+        const_iterator end() const {
+            return const_iterator(tree.cend());
+        }
+
+        const_iterator cbegin() const {
+            return const_iterator(tree.cbegin());
+        }
+
+        const_iterator cend() const {
+            return const_iterator(tree.cend());
+        }
+
+        std::unique_ptr<IIterator<T, false>> GetIterator() override {
+            return std::make_unique<iterator>(begin());
+        }
+
+        std::unique_ptr<IIterator<T, true>> GetConstIterator() const override {
+            return std::make_unique<const_iterator>(cbegin());
+        }
+
+        MultiSet() : total(0) {}
+
+        bool operator==(const MultiSet& other) const {
+            if (total != other.total || tree.Size() != other.tree.Size()) return false;
+            auto it = other.tree.cbegin();
+            return tree.InOrder([&it](const Entry& entry) {
+                if (Engine::CompareKeys(entry, *it) != 0 || entry.count != it->count) return VisitResult::Stop;
+                ++it;
+                return VisitResult::Continue;
+            });
+        }
+        bool operator!=(const MultiSet& other) const {
+            return !(*this == other);
+        }
+
+        // Число ключей с учётом повторов.
+        int Size() const {
+            return total;
+        }
+
+        // Число различных ключей.
+        int UniqueSize() const {
+            return tree.Size();
+        }
+
+        bool IsEmpty() const {
+            return total == 0;
+        }
+
+        void Insert(const T& value, int times = 1) {
+            if (times < 0) throw std::invalid_argument("Count cannot be negative");
+            if (!times) return;
+            auto [it, inserted] = tree.FindOrEmplace(value, value, times);
+            if (!inserted) it->count += times;
+            total += times;
+        }
+
+        void Insert(T&& value, int times = 1) {
+            if (times < 0) throw std::invalid_argument("Count cannot be negative");
+            if (!times) return;
+            // Ключ перемещается в узел только после спуска, когда value больше не нужен для сравнений.
+            auto [it, inserted] = tree.FindOrEmplace(value, std::move(value), times);
+            if (!inserted) it->count += times;
+            total += times;
+        }
+
+        int Count(const T& value) const {
+            auto it = tree.Find(value);
+            return it == tree.cend() ? 0 : it->count;
+        }
+
+        bool Contains(const T& value) const {
+            return tree.Contains(value);
+        }
+
+        // Удаляет одно вхождение; узел освобождается вместе с последним.
+        bool RemoveOne(const T& value) {
+            auto it = tree.Find(value);
+            if (it == tree.end()) return false;
+            if (--it->count == 0) tree.Remove(value);
+            total--;
+            return true;
+        }
+
+        // Удаляет все вхождения и возвращает их число.
+        int RemoveAll(const T& value) {
+            auto it = tree.Find(value);
+            if (it == tree.end()) return 0;
+            int count = it->count;
+            tree.Remove(value);
+            total -= count;
+            return count;
+        }
+
+        T GetMin() const {
+            return tree.GetMin().key;
+        }
+
+        T GetMax() const {
+            return tree.GetMax().key;
+        }
+
+        // Посетитель получает каждое вхождение ключа.
+        template <typename F>
+        bool InOrder(F&& visit) const {
+            return tree.InOrder([&visit](const Entry& entry) {
+                for (int i = 0; i < entry.count; i++) {
+                    if (!VisitKey(visit, entry.key)) return VisitResult::Stop;
+                }
+                return VisitResult::Continue;
+            });
+        }
+
+        // Посетитель получает ключ и число его вхождений, по одному разу на ключ.
+        template <typename F>
+        void ForEachCount(F&& visit) const {
+            tree.InOrder([&visit](const Entry& entry) {visit(entry.key, entry.count);});
+        }
+
+        // Обходит вхождения ключей из [lo, hi) по возрастанию.
+        template <typename F>
+        bool ForEachInRange(const T& lo, const T& hi, F&& visit) const {
+            for (auto it = tree.LowerBound(lo); it != tree.cend() && Compare{}(it->key, hi); ++it) {
+                for (int i = 0; i < it->count; i++) {
+                    if (!VisitKey(visit, it->key)) return false;
+                }
+            }
+            return true;
+        }
+
+        void Clear() {
+            tree.Clear();
+            total = 0;
+        }
+
+        std::string toString() const {
+            std::ostringstream oss;
+            oss << "[";
+            bool first = true;
+            InOrder([&oss, &first](const T& value) {
+                if (!first) oss << ", ";
+                oss << value;
+                first = false;
+            });
+            oss << "]";
+            return oss.str();
+        }
+
+    private:
+        Engine tree;
+        int total;
+};
+
+#endif // MULTISET_HPP
@@ -1,24 +1,61 @@
 #ifndef PRIORITYQUEUE_HPP
 #define PRIORITYQUEUE_HPP
 
-#include "../../auxiliary/Stack.hpp"
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
 #include "../../auxiliary/Iterator.hpp"
+#include "../tree/AVL.hpp"
+#include "../tree/BPlusTree.hpp"
+#include "../tree/TreeHelpers.hpp"
+#include "../parallel/ForkJoinPool.hpp"
 
+// Элемент очереди: приоритет и значение. Значение строится на месте из аргументов после std::in_place.
 template <typename T>
-class PriorityQueue;
+struct PQEntry {
+    PQEntry() = default;
+
+    template <typename... Args>
+    PQEntry(std::in_place_t, int k, Args&&... args) : key(k), value(std::forward<Args>(args)...) {}
 
-template <typename T>
-struct PQ_Node {
-    PQ_Node(T value, int k, PQ_Node<T>* p = nullptr) : value(value), key(k), height(1), left(nullptr), right(nullptr), parent(p) {}
-    T value;
     int key;
-    unsigned char height;
-    PQ_Node<T>* left;
-    PQ_Node<T>* right;
-    PQ_Node<T>* parent;
+    T value;
 };
 
-template <typename T, bool IsConst>
+// Порядок элементов по приоритету. Не зависит от типа значения, поэтому движок,
+// перестроенный через Rebind под PQEntry<U>, упорядочен так же; прозрачен,
+// так что движок ищет и по самому приоритету.
+template <typename Compare>
+struct PriorityOrder {
+    using is_transparent = void;
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        return Compare{}(PriorityOf(a), PriorityOf(b));
+    }
+
+    template <typename A, typename B>
+    static int ThreeWay(const A& a, const B& b) {
+        return ThreeWayCompare<Compare>(PriorityOf(a), PriorityOf(b));
+    }
+
+    static int PriorityOf(int k) {
+        return k;
+    }
+
+    template <typename T>
+    static int PriorityOf(const PQEntry<T>& entry) {
+        return entry.key;
+    }
+};
+
+// Проходит значения элементов по итератору движка Base.
+template <typename Base, typename T, bool IsConst>
 class PQIterator : public IIterator<T, IsConst> {
     public:
         using value_type = typename IIterator<T, IsConst>::value_type;
@@ -27,28 +64,14 @@ class PQIterator : public IIterator<T, IsConst> {
         using difference_type = typename IIterator<T, IsConst>::difference_type;
         using iterator_category = std::bidirectional_iterator_tag;
 
-        using PQ_Ptr = std::conditional_t<IsConst, const PriorityQueue<T>*, PriorityQueue<T>*>;
-
-        PQIterator(PQ_Node<T>* node, PQ_Ptr t) : current(node), queue(t) {}
+        PQIterator(Base b) : current(b) {}
 
         bool HasNext() const override {
-            if (!current) return false;
-            if (current->right) return true;
-            PQ_Node<T>* node = current;
-            while (node->parent && node == node->parent->right) {
-                node = node->parent;
-            }
-            return node->parent != nullptr;
+            return current.HasNext();
         }
 
         bool HasPrev() const {
-            if (!current) return false;
-            if (current->left) return true;
-            PQ_Node<T>* node = current;
-            while (node->parent && node == node->parent->left) {
-                node = node->parent;
-            }
-            return node->parent != nullptr;
+            return current.HasPrev();
         }
 
         reference Current() override {
@@ -64,29 +87,28 @@ class PQIterator : public IIterator<T, IsConst> {
         }
 
         PQIterator& operator++() {
-            toNext();
+            ++current;
             return *this;
         }
 
         PQIterator operator++(int) {
             PQIterator tmp = *this;
-            toNext();
+            ++current;
             return tmp;
         }
 
         PQIterator& operator--() {
-            toPrev();
+            --current;
             return *this;
         }
 
         PQIterator operator--(int) {
             PQIterator tmp = *this;
-            toPrev();
+            --current;
             return tmp;
         }
 
         reference operator*() const {
-            if (!current) throw std::out_of_range("Iterator out of range");
             return current->value;
         }
 
@@ -94,6 +116,10 @@ class PQIterator : public IIterator<T, IsConst> {
             return &(operator*());
         }
 
+        int Priority() const {
+            return current->key;
+        }
+
         bool operator==(const PQIterator& other) const {
             return current == other.current;
         }
@@ -103,87 +129,40 @@ class PQIterator : public IIterator<T, IsConst> {
         }
 
     private:
-        PQ_Node<T>* current;
-        PQ_Ptr queue;
-
-        void toNext() {
-            if (!current) {
-                throw std::out_of_range("Iterator out of range");
-            }
-            if (current == queue->FindMax(queue->root)) {
-                current = nullptr;
-                return;
-            }
-            if (current->right) {
-                current = current->right;
-                while (current->left) {
-                    current = current->left;
-                }
-                return;
-            }
-            PQ_Node<T>* p = current->parent;
-            while (p && current == p->right) {
-                current = p;
-                p = p->parent;
-            }
-            current = p;
-        }
-
-        void toPrev() {
-             if (!current) {
-                if (!queue || !queue->root) {
-                    throw std::out_of_range("Iterator out of range");
-                }
-                current = queue->root;
-                while (current->right) {
-                    current = current->right;
-                }
-                return;
-            }
-            if (current == queue->FindMin(queue->root)) {
-                current = nullptr;
-                return;
-            }
-            if (current->left) {
-                current = current->left;
-                while (current->right) {
-                    current = current->right;
-                }
-                return;
-            }
-            PQ_Node<T>* p = current->parent;
-            while (p && current == p->left) {
-                current = p;
-                p = p->parent;
-            }
-            current = p;
-        }
+        Base current;
 };
 
-template <typename T>
+// Compare задаёт порядок приоритетов; с std::greater<> очередь упорядочена по убыванию.
+// Engine хранит элементы PQEntry<T>, упорядоченные PriorityOrder<Compare>; равные
+// приоритеты идут в порядке вставки, Pop берёт последний вставленный из наибольших.
+template <typename T, typename Compare = std::less<>, typename Engine = AVL_Tree<PQEntry<T>, PriorityOrder<Compare>>>
 class PriorityQueue : public IEnumerable<T> {
     public:
         using value_type = T;
-        using iterator = PQIterator<T, false>;
-        using const_iterator = PQIterator<T, true>;
+        using Entry = PQEntry<T>;
+        using iterator = PQIterator<typename Engine::iterator, T, false>;
+        using const_iterator = PQIterator<typename Engine::const_iterator, T, true>;
+
+        template <typename U>
+        using Rebind = PriorityQueue<U, Compare, typename Engine::template Rebind<PQEntry<U>>>;
 
         iterator begin() { 
-            return iterator(FindMin(root), this);
+            return iterator(tree.begin());
         }
         iterator end() {
-            return iterator(nullptr, this);
+            return iterator(tree.end());
         }
         const_iterator begin() const {
-            return const_iterator(FindMin(root), this);
+            return const_iterator(tree.cbegin());
         }
         const_iterator end() const {
-            return const_iterator(nullptr, this);
+            return const_iterator(tree.cend());
         }
         const_iterator cbegin() const {
-            return const_iterator(FindMin(root), this);
+            return const_iterator(tree.cbegin());
         }
         const_iterator cend() const {
-            return const_iterator(nullptr, this);
+            return const_iterator(tree.cend());
         }
 
         std::unique_ptr<IIterator<T, false>> GetIterator() override {
@@ -193,107 +172,147 @@ class PriorityQueue : public IEnumerable<T> {
             return std::make_unique<const_iterator>(cbegin());
         }
 
-        PriorityQueue() : root(nullptr), size(0) {}
-        PriorityQueue(const PriorityQueue<T>& other) : root(nullptr), size(0) {
-            if (other.size < 0) throw std::invalid_argument("Size cannot be negative");
-            Stack<PQ_Node<T>*> stack;
-            if (other.root) stack.Push(other.root);
-            while (!stack.IsEmpty()) {
-                PQ_Node<T>* current = stack.Top();
-                stack.Pop();
-                this->Push(current->value, current->key);
-                if (current->right) stack.Push(current->right);
-                if (current->left) stack.Push(current->left);
-            }
-        } 
+        template <typename Range>
+        static PriorityQueue* FromSorted(const Range& range) {
+            PriorityQueue* result = new PriorityQueue();
+            result->AssignSorted(range);
+            return result;
+        }
 
         int Size() {
-            return size;
+            return tree.Size();
         }
 
         void Push(const T& value, int key) {
-            Insert(value, key);
+            Insert(key, value);
+        }
+
+        void Push(T&& value, int key) {
+            Insert(key, std::move(value));
+        }
+
+        // Значение строится из args прямо в узле очереди, если движок это умеет.
+        template <typename... Args>
+        void Emplace(int key, Args&&... args) {
+            Insert(key, std::forward<Args>(args)...);
         }
 
         T Pop() {
             if (IsEmpty()) throw std::out_of_range("PriorityQueue is empty");
-            PQ_Node<T>* p = root;
-            while (p->right) {
-                p = p->right;
-            }
-            T result = p->value;
-            Remove(p->key);
-            return result;
+            return std::move(tree.PopMax().value);
         }
 
         const T& Top() const {
             if (IsEmpty()) throw std::out_of_range("PriorityQueue is empty");
-            PQ_Node<T>* p = root;
-            while (p->right) {
-                p = p->right;
-            }
-            return p->value;
+            const_iterator last = cend();
+            return *--last;
         }
 
         bool IsEmpty() const {
-            return size == 0;
+            return tree.Size() == 0;
         }
 
-        PriorityQueue<T>* GetSubQueue(int startIndex, int endIndex) const {
-            if (startIndex < 0 || startIndex >= size || endIndex > size || startIndex > endIndex) throw std::out_of_range("Index out of range");
-            PriorityQueue<T>* result = new PriorityQueue<T>();
-            int i = 0;
-            InOrder([result, &i, &startIndex, &endIndex](const T& value, int k) {
-                if (i >= startIndex && i < endIndex) result->Push(value, k);
-                i++;
-            });
-            return result;
+        // Поиск по полосе приоритетов
+        iterator LowerBound(int priority) {
+            return iterator(tree.LowerBound(priority));
+        }
+        const_iterator LowerBound(int priority) const {
+            return const_iterator(tree.LowerBound(priority));
         }
 
-        PriorityQueue<T>* Concat(PriorityQueue<T>* other) const {
-            PriorityQueue<T>* result = new PriorityQueue<T>(*this);
-            if (other->size <= 0 || !other->root) return result;
-            Stack<PQ_Node<T>*> stack;
-            if (other->root) stack.Push(other->root);
-            while (!stack.IsEmpty()) {
-                PQ_Node<T>* current = stack.Top();
-                stack.Pop();
-                result->Push(current->value, current->key);
-                if (current->right) stack.Push(current->right);
-                if (current->left) stack.Push(current->left);
+        iterator UpperBound(int priority) {
+            return iterator(tree.UpperBound(priority));
+        }
+        const_iterator UpperBound(int priority) const {
+            return const_iterator(tree.UpperBound(priority));
+        }
+
+        // Последний элемент с приоритетом не больше priority или end().
+        iterator Floor(int priority) {
+            iterator it = UpperBound(priority);
+            if (it == begin()) return end();
+            return --it;
+        }
+        const_iterator Floor(int priority) const {
+            const_iterator it = UpperBound(priority);
+            if (it == cbegin()) return cend();
+            return --it;
+        }
+
+        iterator Ceiling(int priority) {
+            return LowerBound(priority);
+        }
+        const_iterator Ceiling(int priority) const {
+            return LowerBound(priority);
+        }
+
+        // Обходит элементы с приоритетами из [lo, hi) за O(log n + k);
+        // посетитель может вернуть VisitResult::Stop.
+        template <typename F>
+        bool ForEachInRange(int lo, int hi, F&& visit) const {
+            for (auto it = tree.LowerBound(lo); it != tree.cend() && Less(it->key, hi); ++it) {
+                if (!VisitItem(visit, it->value, it->key)) return false;
             }
-            return result;
+            return true;
         }
 
-        PriorityQueue<T>* Clutch(PriorityQueue<T>* other) {
-            if (other->size <= 0 || !other->root) return this;
-            Stack<PQ_Node<T>*> stack;
-            if (other->root) stack.Push(other->root);
-            while (!stack.IsEmpty()) {
-                PQ_Node<T>* current = stack.Top();
-                stack.Pop();
-                this->Push(current->value, current->key);
-                if (current->right) stack.Push(current->right);
-                if (current->left) stack.Push(current->left);
+        // Начало ищется по приоритету элемента с номером startIndex и числу элементов
+        // с меньшим приоритетом, дальше элементы копируются подряд.
+        PriorityQueue* GetSubQueue(int startIndex, int endIndex) const {
+            if (startIndex < 0 || startIndex >= tree.Size() || endIndex > tree.Size() || startIndex > endIndex) throw std::out_of_range("Index out of range");
+            int key = tree.Select(startIndex).key;
+            auto it = tree.LowerBound(key);
+            std::advance(it, startIndex - tree.Rank(key));
+            std::vector<std::pair<T, int>> items;
+            items.reserve(endIndex - startIndex);
+            for (int i = startIndex; i < endIndex; i++, ++it) {
+                items.emplace_back(it->value, it->key);
+            }
+            return FromSorted(items);
+        }
+
+        PriorityQueue* Concat(PriorityQueue* other) const {
+            std::vector<std::pair<T, int>> left = Items();
+            std::vector<std::pair<T, int>> right = other->Items();
+            std::vector<std::pair<T, int>> items;
+            items.reserve(left.size() + right.size());
+            std::merge(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(items),
+                [](const std::pair<T, int>& a, const std::pair<T, int>& b) {return Less(a.second, b.second);});
+            return FromSorted(items);
+        }
+
+        // Посетитель получает значение и приоритет; может вернуть VisitResult::Stop.
+        template <typename F>
+        bool InOrder(F&& visit) const { // ЛКП
+            return tree.InOrder([&visit](const Entry& entry) {
+                return VisitItem(visit, entry.value, entry.key) ? VisitResult::Continue : VisitResult::Stop;
+            });
+        }
+
+        PriorityQueue* Clutch(PriorityQueue* other) {
+            if (other->IsEmpty()) return this;
+            for (const auto& [value, key] : other->Items()) {
+                this->Push(value, key);
             }
             return this;
         }
 
         template <typename U>
-        PriorityQueue<U>* Map(std::function<U(T)> f) const {
-            PriorityQueue<U>* result = new PriorityQueue<U>();
-            InOrder([result, f](const T& value, int k) {
-                result->Push(f(value), k);
+        Rebind<U>* Map(std::function<U(T)> f) const {
+            std::vector<std::pair<U, int>> items;
+            items.reserve(tree.Size());
+            InOrder([&items, &f](const T& value, int k) {
+                items.emplace_back(f(value), k);
             });
-            return result;
+            return Rebind<U>::FromSorted(items);
         }
 
-        PriorityQueue<T>* Where(std::function<bool(T)> f) const {
-            PriorityQueue<T>* result = new PriorityQueue<T>();
-            InOrder([result, f](const T& value, int k) {
-                if (f(value)) result->Push(value, k);
+        PriorityQueue* Where(std::function<bool(T)> f) const {
+            std::vector<std::pair<T, int>> items;
+            InOrder([&items, &f](const T& value, int k) {
+                if (f(value)) items.emplace_back(value, k);
             });
-            return result;
+            return FromSorted(items);
         }
 
         T Reduce(std::function<T(T, T)> f, const T& c) const {
@@ -309,39 +328,81 @@ class PriorityQueue : public IEnumerable<T> {
             return answer;
         }
 
-        std::tuple<PriorityQueue<T>*, PriorityQueue<T>*> Split(std::function<bool(const T&)> f) const {
-            PriorityQueue<T>* first = new PriorityQueue<T>();
-            PriorityQueue<T>* second = new PriorityQueue<T>();
-            InOrder([first, second, f](const T& value, int key) {
+        // Параллельные версии: элементы делятся по порядковым номерам на куски, которые
+        // обходятся в пуле независимо; очередь строится из склеенных по порядку кусков.
+        // Движок без параллельного обхода выполняет их последовательно.
+        template <typename U>
+        Rebind<U>* Map(std::function<U(T)> f, ForkJoinPool& pool, int grain = ParallelGrain) const {
+            if constexpr (ParallelTraversal) {
+                std::vector<std::pair<U, int>> items = tree.template Collect<std::pair<U, int>>([&f](const Entry& entry, std::vector<std::pair<U, int>>& out) {
+                    out.emplace_back(f(entry.value), entry.key);
+                }, pool, grain);
+                return Rebind<U>::FromSorted(items);
+            } else {
+                return Map(f);
+            }
+        }
+
+        PriorityQueue* Where(std::function<bool(T)> f, ForkJoinPool& pool, int grain = ParallelGrain) const {
+            if constexpr (ParallelTraversal) {
+                std::vector<std::pair<T, int>> items = tree.template Collect<std::pair<T, int>>([&f](const Entry& entry, std::vector<std::pair<T, int>>& out) {
+                    if (f(entry.value)) out.emplace_back(entry.value, entry.key);
+                }, pool, grain);
+                return FromSorted(items);
+            } else {
+                return Where(f);
+            }
+        }
+
+        // f должна быть ассоциативной, а identity - её нейтральным элементом;
+        // значения сворачиваются в порядке приоритетов. Кусок сворачивается
+        // в единственный элемент своего вектора.
+        T Reduce(std::function<T(T, T)> f, const T& identity, ForkJoinPool& pool, int grain = ParallelGrain) const {
+            std::vector<T> partial;
+            if constexpr (ParallelTraversal) {
+                partial = tree.template Collect<T>([&f, &identity](const Entry& entry, std::vector<T>& out) {
+                    if (out.empty()) out.push_back(identity);
+                    out.back() = f(out.back(), entry.value);
+                }, pool, grain);
+            } else {
+                partial.push_back(identity);
+                InOrder([&partial, &f](const T& value, int) {partial.back() = f(partial.back(), value);});
+            }
+            T result = identity;
+            for (const T& value : partial) result = f(result, value);
+            return result;
+        }
+
+        std::tuple<PriorityQueue*, PriorityQueue*> Split(std::function<bool(const T&)> f) const {
+            std::vector<std::pair<T, int>> firstItems;
+            std::vector<std::pair<T, int>> secondItems;
+            InOrder([&firstItems, &secondItems, &f](const T& value, int key) {
                 if (f(value)) {
-                    first->Push(value, key);
+                    firstItems.emplace_back(value, key);
                 } else {
-                    second->Push(value, key);
+                    secondItems.emplace_back(value, key);
                 }
-            }); 
-            return std::make_tuple(first, second);
+            });
+            return std::make_tuple(FromSorted(firstItems), FromSorted(secondItems));
         }
 
-        static PriorityQueue<T>* fromString(const std::string& data) {
-            PriorityQueue<T>* result = new PriorityQueue<T>();
+        static PriorityQueue* fromString(const std::string& data) {
+            std::vector<std::pair<T, int>> items;
             std::istringstream iss(data);
             char c;
             T value;
             int k;
             while (iss >> c && c == '(') {
                 iss >> value >> c;
-                if (c != ',') {
-                    delete result;
-                    throw std::invalid_argument("Invalid format");
-                }
+                if (c != ',') throw std::invalid_argument("Invalid format");
                 iss >> k >> c;
-                if (c != ')') {
-                    delete result;
-                    throw std::invalid_argument("Invalid format");
-                }
-                result->Push(value, k);
-            }    
-            return result;
+                if (c != ')') throw std::invalid_argument("Invalid format");
+                items.emplace_back(value, k);
+            }
+            std::stable_sort(items.begin(), items.end(), [](const std::pair<T, int>& a, const std::pair<T, int>& b) {
+                return Less(a.second, b.second);
+            });
+            return FromSorted(items);
         }
 
         std::string toString() const {
@@ -358,221 +419,68 @@ class PriorityQueue : public IEnumerable<T> {
         }
 
         void Clear() {
-            if (!root) return;
-            Stack<PQ_Node<T>*> stack;
-            stack.Push(root);
-            while (!stack.IsEmpty()) {
-                PQ_Node<T>* current = stack.Top();
-                stack.Pop();
-                if (current->left) stack.Push(current->left);
-                if (current->right) stack.Push(current->right);
-                delete current;
-            }
-            root = nullptr;
-            size = 0;
-        }
-
-        ~PriorityQueue() { 
-            Clear();
+            tree.Clear();
         }
 
     private:
-        PQ_Node<T>* root;
-        int size;
+        Engine tree;
 
-        template <typename U, bool IsConst>
-        friend class PQIterator;
+        static constexpr int ParallelGrain = 1 << 13;
 
-        void UpdateParent(PQ_Node<T>* node, PQ_Node<T>* newParent) {
-            if (node == root) node->parent = nullptr;
-            if (node) {
-                node->parent = newParent;
-            }
-        }
+        static constexpr bool ParallelTraversal = requires (const Engine& e, ForkJoinPool& pool) {
+            e.template Collect<int>([](const Entry&, std::vector<int>&) {}, pool);
+        };
 
-        void Insert(const T& value, int k) {
-            if (!root) {
-                root = new PQ_Node<T>(value, k, nullptr);
-                size++;
-                return;
-            }
-            Stack<PQ_Node<T>**> path;
-            PQ_Node<T>** current = &root;
-            PQ_Node<T>* parent = nullptr;
-            while (*current) {
-                path.Push(current);
-                parent = *current;
-                if (k < (*current)->key) current = &(*current)->left;
-                else current = &(*current)->right;
-            }
-            *current = new PQ_Node<T>(value, k, parent);
-            while (!path.IsEmpty()) {
-                PQ_Node<T>** p = path.Top();
-                path.Pop();
-                *p = Balance(*p);
-            }
-            size++;
-            root = Balance(root);
-        }
-
-        bool Remove(const T& value, int k) {
-            if (!root) return false;
-            Stack<PQ_Node<T>**> path;
-            PQ_Node<T>** current = &root;
-            PQ_Node<T>* parent = nullptr;
-            while (*current && (*current)->key != k) {
-                path.Push(current);
-                parent = *current;
-                if (k < (*current)->key) current = &(*current)->left;
-                else current = &(*current)->right;
-            }
-            if (!*current) return false;
-            PQ_Node<T>* toDelete = *current;
-            PQ_Node<T>* leftChild = toDelete->left;
-            PQ_Node<T>* rightChild = toDelete->right;
-            
-            if (!rightChild) {
-                *current = leftChild;
-                if (leftChild) {
-                    leftChild->parent = parent;
-                }
-            } else {
-                PQ_Node<T>* min = FindMin(rightChild);
-                min->right = RemoveMin(rightChild);
-                min->left = leftChild;
-                
-                if (min->right) min->right->parent = min;
-                if (min->left) min->left->parent = min;
-                
-                *current = Balance(min);
-                (*current)->parent = parent;
-            }
-            
-            delete toDelete;
-            
-            while (!path.IsEmpty()) {
-                PQ_Node<T>** p = path.Top();
-                path.Pop();
-                *p = Balance(*p);
-            }
-            
-            if (*current != root) {
-                root = Balance(root);
-            }
-            
-            size--;
-            return true;
-        }
-
-        void InOrder(std::function<void(const T&, int)> visit) const { // ЛКП
-            Stack<PQ_Node<T>*> stack;
-            PQ_Node<T>* current = root;
-
-            while (current || !stack.IsEmpty()) {
-                while (current) {
-                    stack.Push(current);
-                    current = current->left;
-                }
-                current = stack.Top();
-                stack.Pop();
-                visit(current->value, current->key);
-                current = current->right;
-            }
-        }
-
-        unsigned char Height(PQ_Node<T>* p) {
-            return p ? p->height : 0;
-        }
-
-        int BFactor(PQ_Node<T>* p) {
-            return Height(p->right) - Height(p->left);
-        }
+        static constexpr bool HasEmplace = requires (Engine& e, Entry entry) {
+            e.Emplace(std::move(entry));
+        };
 
-        void FixHeight(PQ_Node<T>* p) {
-            unsigned char hl = Height(p->left);
-            unsigned char hr = Height(p->right);
-            p->height = (hl > hr ? hl : hr) + 1;
+        static bool Less(int a, int b) {
+            return Compare{}(a, b);
         }
 
-        PQ_Node<T>* RotateRight(PQ_Node<T>* p) {
-            PQ_Node<T>* q = p->left;
-            p->left = q->right;
-            UpdateParent(q->right, p);
-            q->right = p;
-            UpdateParent(q, p->parent);
-            UpdateParent(p, q);
-            FixHeight(p);
-            FixHeight(q);
-            return q;
-        }
-
-        PQ_Node<T>* RotateLeft(PQ_Node<T>* q) {
-            PQ_Node<T>* p = q->right;
-            q->right = p->left;
-            UpdateParent(p->left, q);
-            p->left = q;
-            UpdateParent(p, q->parent);
-            UpdateParent(q, p);
-            FixHeight(q);
-            FixHeight(p);
-            return p;
-        }
-
-        PQ_Node<T>* Balance(PQ_Node<T>* p) {
-            FixHeight(p);
-            if (BFactor(p) == 2) {
-                if (BFactor(p->right) < 0) p->right = RotateRight(p->right);
-                return RotateLeft(p);
-            }
-            if (BFactor(p) == -2) {
-                if (BFactor(p->left) > 0) p->left = RotateLeft(p->left);
-                return RotateRight(p);
+        template <typename F>
+        static bool VisitItem(F& visit, const T& value, int key) {
+            if constexpr (std::is_same_v<std::invoke_result_t<F&, const T&, int>, VisitResult>) {
+                return visit(value, key) == VisitResult::Continue;
+            } else {
+                visit(value, key);
+                return true;
             }
-            return p;
         }
 
-        PQ_Node<T>* RemoveMin(PQ_Node<T>* p) {
-            if (!p->left) {
-                if (p->right) {
-                    p->right->parent = p->parent;
-                }
-                return p->right;
-            }
-            Stack<PQ_Node<T>**> path;
-            PQ_Node<T>** current = &p;
-            PQ_Node<T>* parent = p->parent;
-            while ((*current)->left) {
-                path.Push(current);
-                parent = *current;
-                current = &(*current)->left;
-            }
-            *current = (*current)->right;
-            if (*current) {
-                (*current)->parent = parent;
-            }
-            while (!path.IsEmpty()) {
-                PQ_Node<T>** q = path.Top();
-                path.Pop();
-                *q = Balance(*q);
+        // Место элемента зависит только от приоритета, поэтому AVL_Tree строит
+        // значение из args уже в новом узле; BPlusTree получает готовый элемент.
+        template <typename... Args>
+        void Insert(int k, Args&&... args) {
+            if constexpr (HasEmplace) {
+                tree.Emplace(std::in_place, k, std::forward<Args>(args)...);
+            } else {
+                tree.Insert(Entry(std::in_place, k, std::forward<Args>(args)...));
             }
-            return Balance(p);
         }
 
-        PQ_Node<T>* FindMin(PQ_Node<T>* p) const {
-            if (!p) return nullptr;
-            while (p->left) {
-                p = p->left;
-            }
-            return p;
+        std::vector<std::pair<T, int>> Items() const {
+            std::vector<std::pair<T, int>> items;
+            items.reserve(tree.Size());
+            InOrder([&items](const T& value, int k) {items.emplace_back(value, k);});
+            return items;
         }
 
-        PQ_Node<T>* FindMax(PQ_Node<T>* p) const {
-            if (!p) return nullptr;
-            while (p->right) {
-                p = p->right;
-            }
-            return p;
+        // range - пары (значение, приоритет) по возрастанию приоритета.
+        template <typename Range>
+        void AssignSorted(const Range& range) {
+            std::vector<Entry> entries;
+            entries.reserve(std::distance(std::begin(range), std::end(range)));
+            for (const auto& [value, k] : range) entries.emplace_back(std::in_place, k, value);
+            Engine* built = Engine::FromSorted(entries);
+            tree = std::move(*built);
+            delete built;
         }
 };
 
-#endif // PRIORITYQUEUE_HPP
\ No newline at end of file
+// Очередь на B+-дереве с узлами около NodeBytes байт.
+template <typename T, int NodeBytes = 256, typename Compare = std::less<>>
+using BPlusPriorityQueue = PriorityQueue<T, Compare, BPlusTree<PQEntry<T>, NodeBytes, PriorityOrder<Compare>>>;
+
+#endif // PRIORITYQUEUE_HPP
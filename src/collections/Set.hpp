@@ -1,16 +1,25 @@
 #ifndef SET_HPP
 #define SET_HPP
 
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <span>
 #include "../tree/AVL.hpp"
+#include "../tree/BPlusTree.hpp"
+#include "../tree/PersistentAVL.hpp"
+#include "../tree/FrozenSet.hpp"
 #include "../../auxiliary/Stack.hpp"
 #include "../../auxiliary/Iterator.hpp"
 
-template <typename T>
+// Engine - дерево, на котором построено множество: AVL_Tree, BPlusTree или PersistentAVL_Tree с тем же Compare.
+template <typename T, typename Compare = std::less<>, template <typename> class Allocator = HeapAllocator,
+          typename Engine = AVL_Tree<T, Compare, Allocator>>
 class Set : public IEnumerable<T> {
     public:
         using value_type = T;
-        using iterator = typename AVL_Tree<T>::iterator;
-        using const_iterator = typename AVL_Tree<T>::const_iterator;
+        using iterator = typename Engine::iterator;
+        using const_iterator = typename Engine::const_iterator;
 
         iterator begin() { 
             return tree->begin();
@@ -21,11 +30,11 @@ class Set : public IEnumerable<T> {
         }
         
         const_iterator begin() const {
-            return tree->begin();
+            return tree->cbegin();
         }
         
         const_iterator end() const {
-            return tree->end();
+            return tree->cend();
         }
         
         const_iterator cbegin() const {
@@ -44,17 +53,42 @@ class Set : public IEnumerable<T> {
             return tree->GetConstIterator();
         }
 
-        Set() : tree(new AVL_Tree<T>()) {}
+        Set() : tree(new Engine()) {}
+        Set(const Set& other) : tree(new Engine(*other.tree)) {}
+        Set(Set&& other) : tree(new Engine(std::move(*other.tree))) {}
+
+        Set& operator=(const Set& other) {
+            if (this == &other) return *this;
+            *tree = *other.tree;
+            return *this;
+        }
+
+        Set& operator=(Set&& other) {
+            if (this == &other) return *this;
+            *tree = std::move(*other.tree);
+            return *this;
+        }
 
-        bool operator==(const Set<T>& other) const {
+        template <typename Range>
+        static Set* FromSorted(const Range& range) {
+            std::vector<T> values;
+            for (const T& value : range) {
+                if (values.empty() || Engine::CompareKeys(values.back(), value) != 0) values.push_back(value);
+            }
+            return new Set(Engine::FromSorted(values));
+        }
+
+        // Оба множества обходятся по возрастанию одновременно до первого расхождения.
+        bool operator==(const Set& other) const {
             if (Size() != other.Size()) return false;
-            bool isEqual = true;
-            tree->InOrder([&other, &isEqual](const T& value) {
-                if (!other.Contains(value)) isEqual = false;
+            const_iterator it = other.cbegin();
+            return tree->InOrder([&it](const T& value) {
+                if (Engine::CompareKeys(value, *it) != 0) return VisitResult::Stop;
+                ++it;
+                return VisitResult::Continue;
             });
-            return isEqual;
         }
-        bool operator!=(const Set<T>& other) const {
+        bool operator!=(const Set& other) const {
             return !(*this == other);
         }
 
@@ -62,83 +96,239 @@ class Set : public IEnumerable<T> {
             return tree->Size();
         }
 
-        void Insert(const T& value) {
-            if (!Contains(value)) tree->Insert(value);
+        // Возвращает false, если значение уже было в множестве. Движок с InsertUnique
+        // вставляет за один спуск, остальные сначала ищут ключ.
+        bool Insert(const T& value) {
+            if constexpr (HasUniqueInsert) {
+                return tree->InsertUnique(value);
+            } else {
+                if (Contains(value)) return false;
+                tree->Insert(value);
+                return true;
+            }
+        }
+
+        bool Insert(T&& value) {
+            if constexpr (HasUniqueInsert) {
+                return tree->InsertUnique(std::move(value));
+            } else {
+                if (Contains(value)) return false;
+                tree->Insert(std::move(value));
+                return true;
+            }
+        }
+
+        // Значение строится из args на месте, если движок это умеет, иначе перемещается в него.
+        template <typename... Args>
+        void Emplace(Args&&... args) {
+            if constexpr (requires (Engine& e) { e.EmplaceUnique(std::forward<Args>(args)...); }) {
+                tree->EmplaceUnique(std::forward<Args>(args)...);
+            } else {
+                Insert(T(std::forward<Args>(args)...));
+            }
+        }
+
+        template <typename Range>
+        void InsertMany(const Range& range) {
+            tree->InsertManyUnique(range);
         }
 
         bool Erase(const T& value) {
             return tree->Remove(value);
         }
 
+        template <typename K> requires Engine::IsTransparent
+        bool Erase(const K& value) {
+            return tree->Remove(value);
+        }
+
         bool Contains(const T& value) const {
             return tree->Contains(value);
         }
 
+        template <typename K> requires Engine::IsTransparent
+        bool Contains(const K& value) const {
+            return tree->Contains(value);
+        }
+
+        void ContainsMany(std::span<const T> values, std::span<bool> out) const {
+            tree->ContainsMany(values, out);
+        }
+
+        std::vector<iterator> FindMany(std::span<const T> values) {
+            return tree->FindMany(values);
+        }
+        std::vector<const_iterator> FindMany(std::span<const T> values) const {
+            return static_cast<const Engine*>(tree)->FindMany(values);
+        }
+
+        iterator Find(const T& value) {
+            return tree->Find(value);
+        }
+        const_iterator Find(const T& value) const {
+            return static_cast<const Engine*>(tree)->Find(value);
+        }
+
+        template <typename K> requires Engine::IsTransparent
+        iterator Find(const K& value) {
+            return tree->Find(value);
+        }
+        template <typename K> requires Engine::IsTransparent
+        const_iterator Find(const K& value) const {
+            return static_cast<const Engine*>(tree)->Find(value);
+        }
+
         bool IsEmpty() const {
             return Size() == 0;
         }
 
-        void Union(const Set<T>* other) {
-            other->tree->PreOrder([this](const T& value) {this->Insert(value);});
+        template <typename F>
+        bool InOrder(F&& visit) const {
+            return tree->InOrder(std::forward<F>(visit));
+        }
+
+        template <typename F>
+        bool ReverseInOrder(F&& visit) const {
+            return tree->ReverseInOrder(std::forward<F>(visit));
+        }
+
+        template <typename F>
+        iterator FindFirst(F&& pred) {
+            return tree->FindFirst(std::forward<F>(pred));
+        }
+        template <typename F>
+        const_iterator FindFirst(F&& pred) const {
+            return static_cast<const Engine*>(tree)->FindFirst(std::forward<F>(pred));
+        }
+
+        iterator LowerBound(const T& value) {
+            return tree->LowerBound(value);
+        }
+        const_iterator LowerBound(const T& value) const {
+            return static_cast<const Engine*>(tree)->LowerBound(value);
+        }
+
+        iterator UpperBound(const T& value) {
+            return tree->UpperBound(value);
+        }
+        const_iterator UpperBound(const T& value) const {
+            return static_cast<const Engine*>(tree)->UpperBound(value);
+        }
+
+        iterator Floor(const T& value) {
+            return tree->Floor(value);
+        }
+        const_iterator Floor(const T& value) const {
+            return static_cast<const Engine*>(tree)->Floor(value);
+        }
+
+        iterator Ceiling(const T& value) {
+            return tree->Ceiling(value);
+        }
+        const_iterator Ceiling(const T& value) const {
+            return static_cast<const Engine*>(tree)->Ceiling(value);
+        }
+
+        template <typename F>
+        void ForEachInRange(const T& lo, const T& hi, F&& visit) const {
+            tree->ForEachInRange(lo, hi, std::forward<F>(visit));
+        }
+
+        int Rank(const T& value) const {
+            return tree->Rank(value);
+        }
+
+        T Select(int index) const {
+            return tree->Select(index);
+        }
+
+        int CountRange(const T& lo, const T& hi) const {
+            return tree->CountRange(lo, hi);
+        }
+
+        void Union(const Set* other) {
+            tree->UnionWith(*other->tree);
         }
-        static Set<T>* Union(const Set<T>* left, const Set<T>* right) {
-            Set<T>* result = new Set<T>();
-            left->tree->PreOrder([result](const T& value) {result->Insert(value);});
-            right->tree->PreOrder([result](const T& value) {result->Insert(value);});
+        static Set* Union(const Set* left, const Set* right) {
+            if (left->Size() < right->Size()) std::swap(left, right);
+            Set* result = new Set(*left);
+            result->tree->UnionWith(*right->tree);
             return result;
         }
 
-        void Intersection(const Set<T>* other) {
-            std::vector<T> toRemove;
-            tree->PreOrder([other, &toRemove](const T& value) {
-                if (!other->Contains(value)) toRemove.push_back(value);
-            });
-            for (const T& value : toRemove) {
-                tree->Remove(value);
-            }
+        void Intersection(const Set* other) {
+            tree->IntersectWith(*other->tree);
         }
-        static Set<T>* Intersection(const Set<T>* left, const Set<T>* right) {
-            Set<T>* result = new Set<T>();
-            left->tree->PreOrder([right, result](const T& value) {
-                if (right->Contains(value)) result->Insert(value);
-            });
+        static Set* Intersection(const Set* left, const Set* right) {
+            if (left->Size() > right->Size()) std::swap(left, right);
+            Set* result = new Set(*left);
+            result->tree->IntersectWith(*right->tree);
             return result;
         }
 
-        void Difference(const Set<T>* other) {
-            std::vector<T> toRemove;
-            tree->PreOrder([other, &toRemove](const T& value) {
-                if (other->Contains(value)) toRemove.push_back(value);
-            });
-            for (const T& value : toRemove) {
-                tree->Remove(value);
-            }
+        void Difference(const Set* other) {
+            tree->DifferenceWith(*other->tree);
         }
-        static Set<T>* Difference(const Set<T>* left, const Set<T>* right) {
-            Set<T>* result = new Set<T>();
-            left->tree->PreOrder([right, result](const T& value) {
-                if (!right->Contains(value)) result->Insert(value);
-            });
+        static Set* Difference(const Set* left, const Set* right) {
+            Set* result = new Set(*left);
+            result->tree->DifferenceWith(*right->tree);
             return result;
         }
 
-        template <typename U>
-        Set<U>* Map(std::function<U(T)> f) const {
-            Set<U>* result = new Set<U>();
-            tree->PreOrder([result, f](const T& value) {
-                result->Insert(f(value));
-            });
+        void Union(const Set* other, ForkJoinPool& pool) {
+            UnionWith(*tree, *other->tree, pool);
+        }
+        static Set* Union(const Set* left, const Set* right, ForkJoinPool& pool) {
+            if (left->Size() < right->Size()) std::swap(left, right);
+            Set* result = new Set(*left);
+            UnionWith(*result->tree, *right->tree, pool);
             return result;
         }
 
-        Set<T>* Where(std::function<bool(T)> f) const {
-            Set<T>* result = new Set<T>();
-            tree->PreOrder([result, f](const T& value) {
-                if (f(value)) result->Insert(value);
-            });
+        void Intersection(const Set* other, ForkJoinPool& pool) {
+            IntersectWith(*tree, *other->tree, pool);
+        }
+        static Set* Intersection(const Set* left, const Set* right, ForkJoinPool& pool) {
+            if (left->Size() > right->Size()) std::swap(left, right);
+            Set* result = new Set(*left);
+            IntersectWith(*result->tree, *right->tree, pool);
+            return result;
+        }
+
+        void Difference(const Set* other, ForkJoinPool& pool) {
+            DifferenceWith(*tree, *other->tree, pool);
+        }
+        static Set* Difference(const Set* left, const Set* right, ForkJoinPool& pool) {
+            Set* result = new Set(*left);
+            DifferenceWith(*result->tree, *right->tree, pool);
             return result;
         }
 
+        template <typename U>
+        Set<U, Compare, Allocator, typename Engine::template Rebind<U>>* Map(std::function<U(T)> f) const {
+            std::vector<U> values;
+            values.reserve(Size());
+            tree->InOrder([&values, &f](const T& value) {values.push_back(f(value));});
+            std::stable_sort(values.begin(), values.end(), Compare{});
+            return Set<U, Compare, Allocator, typename Engine::template Rebind<U>>::FromSorted(values);
+        }
+
+        Set* Where(std::function<bool(T)> f) const {
+            std::vector<T> values;
+            tree->InOrder([&values, &f](const T& value) {
+                if (f(value)) values.push_back(value);
+            });
+            return new Set(Engine::FromSorted(values));
+        }
+
+        Set* Where(std::function<bool(T)> f, int limit) const {
+            return new Set(tree->Where(f, limit));
+        }
+
+        Set* TakeWhile(std::function<bool(T)> f) const {
+            return new Set(tree->TakeWhile(f));
+        }
+
         T Reduce(std::function<T(T, T)> f, const T& c) const {
             T answer = 0;
             int i = 1;
@@ -152,19 +342,62 @@ class Set : public IEnumerable<T> {
             return answer;
         }
 
-        static Set<T>* fromString(const std::string& data) {
-            Set<T>* result = new Set<T>();
+        // Параллельные Map, Where и Reduce; движки без них выполняют работу последовательно.
+        template <typename U>
+        Set<U, Compare, Allocator, typename Engine::template Rebind<U>>* Map(std::function<U(T)> f, ForkJoinPool& pool) const {
+            if constexpr (ParallelTraversal) {
+                std::vector<U> values = tree->template Collect<U>([&f](const T& value, std::vector<U>& out) {out.push_back(f(value));}, pool);
+                if (!std::is_sorted(values.begin(), values.end(), Compare{})) std::stable_sort(values.begin(), values.end(), Compare{});
+                return Set<U, Compare, Allocator, typename Engine::template Rebind<U>>::FromSorted(values);
+            } else {
+                return Map(f);
+            }
+        }
+
+        Set* Where(std::function<bool(T)> f, ForkJoinPool& pool) const {
+            if constexpr (ParallelTraversal) return new Set(tree->Where(f, pool));
+            else return Where(f);
+        }
+
+        // f должна быть ассоциативной, а identity - её нейтральным элементом.
+        T Reduce(std::function<T(T, T)> f, const T& identity, ForkJoinPool& pool) const {
+            if constexpr (ParallelTraversal) {
+                return tree->Reduce(f, identity, pool);
+            } else {
+                T result = identity;
+                tree->InOrder([&result, &f](const T& value) {result = f(result, value);});
+                return result;
+            }
+        }
+
+        FrozenSet<T, Compare>* Freeze() const {
+            return tree->Freeze();
+        }
+
+        // Ленивое удаление с уплотнением, см. AVL_Tree::SetLazyRemove.
+        void SetLazyRemove(double maxDeadFraction) requires requires (Engine& e) { e.SetLazyRemove(0.5); } {
+            tree->SetLazyRemove(maxDeadFraction);
+        }
+
+        // Версия множества на текущий момент за O(1); есть только у персистентного движка.
+        Set* Snapshot() const requires requires (const Engine& e) { e.Snapshot(); } {
+            return new Set(tree->Snapshot());
+        }
+
+        static Set* fromString(const std::string& data) {
+            std::vector<T> values;
             std::istringstream iss(data);
             char c;
             T value;
             if (iss >> value) {
-                result->Insert(value);
+                values.push_back(value);
                 while (iss >> c >> value) {
                     if (c != ',') break;
-                    result->Insert(value);
+                    values.push_back(value);
                 }
-            }    
-            return result;
+            }
+            std::stable_sort(values.begin(), values.end(), Compare{});
+            return FromSorted(values);
         }
 
         std::string toString() const {
@@ -189,7 +422,45 @@ class Set : public IEnumerable<T> {
         }
 
     private:
-        AVL_Tree<T>* tree;
+        Engine* tree;
+
+        explicit Set(Engine* t) : tree(t) {}
+
+        // Движки без параллельных версий операций выполняют их последовательно.
+        static constexpr bool ParallelEngine = requires (Engine& a, const Engine& b, ForkJoinPool& pool) {
+            a.UnionWith(b, pool);
+        };
+
+        static constexpr bool ParallelTraversal = requires (const Engine& e, std::function<bool(T)> f, ForkJoinPool& pool) {
+            e.Where(f, pool);
+        };
+
+        static constexpr bool HasUniqueInsert = requires (Engine& e, const T& value) {
+            e.InsertUnique(value);
+        };
+
+        static void UnionWith(Engine& target, const Engine& source, ForkJoinPool& pool) {
+            if constexpr (ParallelEngine) target.UnionWith(source, pool);
+            else target.UnionWith(source);
+        }
+
+        static void IntersectWith(Engine& target, const Engine& source, ForkJoinPool& pool) {
+            if constexpr (ParallelEngine) target.IntersectWith(source, pool);
+            else target.IntersectWith(source);
+        }
+
+        static void DifferenceWith(Engine& target, const Engine& source, ForkJoinPool& pool) {
+            if constexpr (ParallelEngine) target.DifferenceWith(source, pool);
+            else target.DifferenceWith(source);
+        }
 };
 
+// Множество на B+-дереве с узлами около NodeBytes байт.
+template <typename T, int NodeBytes = 256, typename Compare = std::less<>>
+using BPlusSet = Set<T, Compare, HeapAllocator, BPlusTree<T, NodeBytes, Compare>>;
+
+// Множество с копированием пути: копия и Snapshot() стоят O(1).
+template <typename T, typename Compare = std::less<>>
+using PersistentSet = Set<T, Compare, HeapAllocator, PersistentAVL_Tree<T, Compare>>;
+
 #endif // SET_HPP
\ No newline at end of file
@@ -0,0 +1,295 @@
+#ifndef SHARDEDSET_HPP
+#define SHARDEDSET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../tree/AVL.hpp"
+#include "../parallel/EpochDomain.hpp"
+
+// Множество для многопоточной вставки: пространство ключей делится разделителями на диапазоны,
+// каждый хранится в своём шарде - AVL_Tree под своим мьютексом, так что потоки, пишущие в разные
+// диапазоны, не мешают друг другу. Шард, выросший вдвое больше средней доли, делится по медиане
+// в свободный шард; если свободных нет, один освобождается слиянием двух соседних диапазонов
+// с наименьшим числом ключей. Остальные шарды при этом не блокируются и не копируются.
+// Разбиение публикуется атомарно и освобождается через EpochDomain; шард хранит границы своего
+// диапазона, и операция, пришедшая в шард по устаревшему разбиению, повторяется.
+template <typename T, typename Compare = std::less<>>
+class ShardedSet {
+    public:
+        using value_type = T;
+
+        explicit ShardedSet(int shards = (int)std::thread::hardware_concurrency())
+            : count(std::max(shards, 1)), parts(new Shard[count]), layout(new Layout{{}, {0}, MinShardSize}) {
+            parts[0].active = true;
+        }
+
+        ShardedSet(const ShardedSet&) = delete;
+        ShardedSet& operator=(const ShardedSet&) = delete;
+
+        int Shards() const {
+            return count;
+        }
+
+        bool Insert(const T& value) {
+            bool inserted = false;
+            bool overfull = false;
+            WithShard(value, [&](Shard& shard, const Layout& current) {
+                inserted = shard.tree.InsertUnique(value);
+                overfull = inserted && shard.tree.Size() > current.limit;
+            });
+            if (overfull) Split(value);
+            return inserted;
+        }
+
+        bool Erase(const T& value) {
+            bool erased = false;
+            WithShard(value, [&](Shard& shard, const Layout&) {
+                erased = shard.tree.Remove(value);
+            });
+            return erased;
+        }
+
+        bool Contains(const T& value) const {
+            bool found = false;
+            WithShard(value, [&](Shard& shard, const Layout&) {
+                found = shard.tree.Contains(value);
+            });
+            return found;
+        }
+
+        // Шарды считаются по очереди, поэтому при параллельных записях
+        // результат - лишь оценка.
+        int Size() const {
+            int total = 0;
+            for (int i = 0; i < count; i++) {
+                std::lock_guard<std::mutex> lock(parts[i].mutex);
+                total += parts[i].tree.Size();
+            }
+            return total;
+        }
+
+        bool IsEmpty() const {
+            return Size() == 0;
+        }
+
+        // Упорядоченные обходы переходят из шарда в шард по границам диапазонов, так что
+        // перераскладка между шардами не приводит к пропускам и повторам. Каждый шард
+        // просматривается под своей блокировкой; посетитель не должен обращаться к множеству.
+        template <typename F>
+        bool InOrder(F&& visit) const {
+            return Visit(std::nullopt, std::nullopt, visit);
+        }
+
+        // Обходит ключи из [lo, hi) по возрастанию.
+        template <typename F>
+        bool ForEachInRange(const T& lo, const T& hi, F&& visit) const {
+            return Visit(lo, hi, visit);
+        }
+
+        int CountRange(const T& lo, const T& hi) const {
+            int total = 0;
+            auto counter = [&total](const T&) {total++;};
+            Visit(lo, hi, counter);
+            return total;
+        }
+
+        std::vector<T> ToVector() const {
+            std::vector<T> values;
+            InOrder([&values](const T& value) {values.push_back(value);});
+            return values;
+        }
+
+        void Clear() {
+            for (int i = 0; i < count; i++) {
+                std::lock_guard<std::mutex> lock(parts[i].mutex);
+                parts[i].tree.Clear();
+            }
+        }
+
+        // Других потоков, работающих с множеством, к этому моменту быть не должно.
+        ~ShardedSet() {
+            delete layout.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // Ключи диапазона [splitters[i - 1], splitters[i]) лежат в шарде owners[i]; limit - размер,
+        // после которого шард считается переполненным.
+        struct Layout {
+            std::vector<T> splitters;
+            std::vector<int> owners;
+            int limit;
+        };
+
+        // Границы меняются только под mutex; пустая граница - бесконечность. Шард, не владеющий
+        // никаким диапазоном, неактивен.
+        struct alignas(64) Shard {
+            mutable std::mutex mutex;
+            AVL_Tree<T, Compare> tree;
+            std::optional<T> low;
+            std::optional<T> high;
+            bool active = false;
+        };
+
+        static constexpr int MinShardSize = 4096;
+
+        int count;
+        std::unique_ptr<Shard[]> parts;
+        std::atomic<const Layout*> layout;
+        std::mutex splitting;
+
+        static int RangeOf(const Layout& current, const T& value) {
+            return (int)(std::upper_bound(current.splitters.begin(), current.splitters.end(), value, Compare{}) - current.splitters.begin());
+        }
+
+        static bool Holds(const Shard& shard, const T& value) {
+            return shard.active && (!shard.low || !Compare{}(value, *shard.low)) && (!shard.high || Compare{}(value, *shard.high));
+        }
+
+        template <typename F>
+        void WithShard(const T& value, F&& action) const {
+            while (true) {
+                auto pin = EpochDomain::Global().Pin();
+                const Layout* current = layout.load(std::memory_order_acquire);
+                Shard& shard = parts[current->owners[RangeOf(*current, value)]];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (!Holds(shard, value)) continue;
+                action(shard, *current);
+                return;
+            }
+        }
+
+        // Делит шард, в который попадает value, если он всё ещё переполнен. Разбиение меняет
+        // только один поток; если деление уже идёт, вызов ничего не делает.
+        void Split(const T& value) {
+            std::unique_lock<std::mutex> guard(splitting, std::try_to_lock);
+            if (!guard.owns_lock()) return;
+            const Layout* current = layout.load(std::memory_order_acquire);
+            int limit = std::max(MinShardSize, 2 * Size() / count);
+            int slot = current->owners[RangeOf(*current, value)];
+            bool overfull;
+            {
+                std::lock_guard<std::mutex> lock(parts[slot].mutex);
+                overfull = parts[slot].tree.Size() > limit;
+            }
+            if (overfull && (int)current->owners.size() == count) {
+                overfull = Merge(slot, limit);
+                current = layout.load(std::memory_order_relaxed);
+            }
+            Layout* next = new Layout(*current);
+            next->limit = limit;
+            if (!overfull) {
+                Publish(next);
+                return;
+            }
+
+            int range = (int)(std::find(current->owners.begin(), current->owners.end(), slot) - current->owners.begin());
+            int free = 0;
+            while (std::find(current->owners.begin(), current->owners.end(), free) != current->owners.end()) free++;
+            Shard& lower = parts[slot];
+            Shard& upper = parts[free];
+            std::scoped_lock locks(lower.mutex, upper.mutex);
+            if (lower.tree.Size() <= limit) {
+                Publish(next);
+                return;
+            }
+            std::vector<T> values = Keys(lower.tree);
+            int half = (int)values.size() / 2;
+            const T& median = values[half];
+            Assign(upper.tree, std::span<const T>(values.data() + half, values.size() - half));
+            Assign(lower.tree, std::span<const T>(values.data(), half));
+            upper.low = median;
+            upper.high = std::move(lower.high);
+            lower.high = median;
+            upper.active = true;
+            next->splitters.insert(next->splitters.begin() + range, median);
+            next->owners.insert(next->owners.begin() + range + 1, free);
+            // Разбиение публикуется до снятия блокировок: поток, дождавшийся шарда и
+            // не нашедший в нём своего ключа, перечитает уже новое разбиение.
+            Publish(next);
+        }
+
+        // Сливает два соседних диапазона с наименьшим числом ключей, если их сумма не больше
+        // limit, и освобождает шард правого из них. Шард keep в слиянии не участвует.
+        bool Merge(int keep, int limit) {
+            const Layout* current = layout.load(std::memory_order_relaxed);
+            int ranges = (int)current->owners.size();
+            std::vector<int> sizes(ranges);
+            for (int i = 0; i < ranges; i++) {
+                std::lock_guard<std::mutex> lock(parts[current->owners[i]].mutex);
+                sizes[i] = parts[current->owners[i]].tree.Size();
+            }
+            int best = -1;
+            for (int i = 0; i + 1 < ranges; i++) {
+                if (current->owners[i] == keep || current->owners[i + 1] == keep) continue;
+                if (sizes[i] + sizes[i + 1] <= limit && (best < 0 || sizes[i] + sizes[i + 1] < sizes[best] + sizes[best + 1])) best = i;
+            }
+            if (best < 0) return false;
+
+            Shard& left = parts[current->owners[best]];
+            Shard& right = parts[current->owners[best + 1]];
+            std::scoped_lock locks(left.mutex, right.mutex);
+            std::vector<T> values = Keys(left.tree);
+            right.tree.InOrder([&values](const T& value) {values.push_back(value);});
+            Assign(left.tree, std::span<const T>(values));
+            right.tree.Clear();
+            left.high = std::move(right.high);
+            right.low.reset();
+            right.high.reset();
+            right.active = false;
+            Layout* next = new Layout(*current);
+            next->splitters.erase(next->splitters.begin() + best);
+            next->owners.erase(next->owners.begin() + best + 1);
+            Publish(next);
+            return true;
+        }
+
+        void Publish(Layout* next) {
+            const Layout* previous = layout.exchange(next, std::memory_order_acq_rel);
+            EpochDomain::Global().Retire(const_cast<Layout*>(previous));
+        }
+
+        static std::vector<T> Keys(const AVL_Tree<T, Compare>& tree) {
+            std::vector<T> values;
+            values.reserve(tree.Size());
+            tree.InOrder([&values](const T& value) {values.push_back(value);});
+            return values;
+        }
+
+        static void Assign(AVL_Tree<T, Compare>& tree, std::span<const T> values) {
+            AVL_Tree<T, Compare>* built = AVL_Tree<T, Compare>::FromSorted(values);
+            tree = std::move(*built);
+            delete built;
+        }
+
+        // Курсор - нижняя граница ещё не просмотренных ключей; после каждого шарда
+        // он переходит на его правый разделитель.
+        template <typename F>
+        bool Visit(std::optional<T> cursor, const std::optional<T>& hi, F& visit) const {
+            while (true) {
+                auto pin = EpochDomain::Global().Pin();
+                const Layout* current = layout.load(std::memory_order_acquire);
+                Shard& shard = parts[current->owners[cursor ? RangeOf(*current, *cursor) : 0]];
+                std::unique_lock<std::mutex> lock(shard.mutex);
+                if (cursor ? !Holds(shard, *cursor) : !shard.active || shard.low) continue;
+
+                const AVL_Tree<T, Compare>& tree = shard.tree;
+                auto it = cursor ? tree.LowerBound(*cursor) : tree.cbegin();
+                for (; it != tree.cend(); ++it) {
+                    if (hi && !Compare{}(*it, *hi)) return true;
+                    if (!VisitKey(visit, *it)) return false;
+                }
+                if (!shard.high) return true;
+                cursor = shard.high;
+                if (hi && !Compare{}(*cursor, *hi)) return true;
+            }
+        }
+};
+
+#endif // SHARDEDSET_HPP
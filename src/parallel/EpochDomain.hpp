@@ -0,0 +1,173 @@
+#ifndef EPOCHDOMAIN_HPP
+#define EPOCHDOMAIN_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Освобождение памяти по эпохам. Читатель на время доступа к общим данным закрепляется
+// в текущей эпохе (Pin), писатель отдаёт отцепленные объекты в Retire. Объект, снятый
+// в эпоху e, удаляется, когда глобальная эпоха дошла до e + 2: к этому моменту каждый
+// закреплённый поток успел увидеть эпоху новее e и не может держать на него ссылку.
+// Эпоха сдвигается, только если все закреплённые потоки уже в ней, поэтому читатель,
+// застрявший внутри Pin, задерживает освобождение, но никого не блокирует.
+class EpochDomain {
+    private:
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> epoch{Idle};
+            std::atomic<bool> used{false};
+            int depth = 0;
+        };
+
+    public:
+        static constexpr int MaxThreads = 256;
+
+        // Закрепление действует до разрушения Guard; вложенные Pin в одном потоке допустимы.
+        class Guard {
+            public:
+                Guard(const Guard&) = delete;
+                Guard& operator=(const Guard&) = delete;
+
+                ~Guard() {
+                    if (--slot->depth == 0) slot->epoch.store(Idle, std::memory_order_release);
+                }
+
+            private:
+                friend class EpochDomain;
+                explicit Guard(Slot* s) : slot(s) {}
+                Slot* slot;
+        };
+
+        EpochDomain() : epoch(0) {}
+
+        EpochDomain(const EpochDomain&) = delete;
+        EpochDomain& operator=(const EpochDomain&) = delete;
+
+        // Общий для всех структур домен; потоки регистрируются в нём при первом Pin.
+        // Собственный домен должен пережить все потоки, которые в нём закреплялись.
+        static EpochDomain& Global() {
+            static EpochDomain domain;
+            return domain;
+        }
+
+        [[nodiscard]] Guard Pin() {
+            Slot* slot = &slots[LocalSlot()];
+            if (slot->depth++ == 0) {
+                slot->epoch.store(epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                // Объявление эпохи должно стать видимым до чтения общих указателей.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+            return Guard(slot);
+        }
+
+        template <typename U>
+        void Retire(U* object) {
+            Retire(object, [](void* p) {delete static_cast<U*>(p);});
+        }
+
+        void Retire(void* object, void (*deleter)(void*)) {
+            std::vector<Retired> ready;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                limbo.push_back({object, deleter, epoch.load(std::memory_order_relaxed)});
+                if ((int)limbo.size() < CollectThreshold) return;
+                TryAdvance();
+                Collect(ready);
+            }
+            for (Retired& item : ready) item.deleter(item.object);
+        }
+
+        // Ждёт, пока станет можно удалить всё снятое до вызова, и удаляет его.
+        // Нельзя вызывать изнутри Pin: эпоха не сдвинется дальше закрепления самого потока.
+        void Synchronize() {
+            std::vector<Retired> ready;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                uint64_t target = epoch.load(std::memory_order_relaxed) + 2;
+                while (epoch.load(std::memory_order_relaxed) < target) {
+                    TryAdvance();
+                    std::this_thread::yield();
+                }
+                Collect(ready);
+            }
+            for (Retired& item : ready) item.deleter(item.object);
+        }
+
+        // Число объектов, ещё ожидающих удаления.
+        int Pending() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return (int)limbo.size();
+        }
+
+        // К моменту разрушения домена читателей уже нет.
+        ~EpochDomain() {
+            for (Retired& item : limbo) item.deleter(item.object);
+        }
+
+    private:
+        static constexpr uint64_t Idle = UINT64_MAX;
+        static constexpr int CollectThreshold = 64;
+
+        struct Retired {
+            void* object;
+            void (*deleter)(void*);
+            uint64_t epoch;
+        };
+
+        // Места в slots закрепляются за потоком до его завершения.
+        struct Registrations {
+            std::vector<std::pair<EpochDomain*, int>> items;
+
+            ~Registrations() {
+                for (auto [domain, index] : items) domain->slots[index].used.store(false, std::memory_order_release);
+            }
+        };
+
+        Slot slots[MaxThreads];
+        std::atomic<uint64_t> epoch;
+        mutable std::mutex mutex;
+        std::vector<Retired> limbo;
+
+        int LocalSlot() {
+            static thread_local Registrations registrations;
+            for (auto [domain, index] : registrations.items) {
+                if (domain == this) return index;
+            }
+            for (int i = 0; i < MaxThreads; i++) {
+                bool expected = false;
+                if (!slots[i].used.load(std::memory_order_relaxed)
+                    && slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    registrations.items.emplace_back(this, i);
+                    return i;
+                }
+            }
+            throw std::length_error("Too many threads in epoch domain");
+        }
+
+        // Сдвигает эпоху, если все закреплённые потоки уже видели текущую.
+        void TryAdvance() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint64_t current = epoch.load(std::memory_order_relaxed);
+            for (const Slot& slot : slots) {
+                uint64_t observed = slot.epoch.load(std::memory_order_acquire);
+                if (observed != Idle && observed != current) return;
+            }
+            epoch.compare_exchange_strong(current, current + 1, std::memory_order_acq_rel);
+        }
+
+        void Collect(std::vector<Retired>& ready) {
+            uint64_t current = epoch.load(std::memory_order_relaxed);
+            std::size_t kept = 0;
+            for (Retired& item : limbo) {
+                if (item.epoch + 2 <= current) ready.push_back(item);
+                else limbo[kept++] = item;
+            }
+            limbo.resize(kept);
+        }
+};
+
+#endif // EPOCHDOMAIN_HPP
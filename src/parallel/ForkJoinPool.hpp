@@ -0,0 +1,199 @@
+#ifndef FORKJOINPOOL_HPP
+#define FORKJOINPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Пул с перехватом работы для рекурсивного параллелизма вида "fork-join".
+// Invoke(a, b) кладёт b в очередь текущего потока, выполняет a и затем либо
+// забирает b обратно, либо, пока b выполняется чужим потоком, помогает пулу.
+// Поток, вызвавший Invoke извне, участвует в работе наравне с рабочими,
+// поэтому пул на threads потоков запускает threads - 1 рабочих.
+class ForkJoinPool {
+    public:
+        explicit ForkJoinPool(int threads = std::thread::hardware_concurrency()) : stop(false), pending(0) {
+            if (threads < 1) threads = 1;
+            for (int i = 0; i < threads; i++) {
+                queues.push_back(std::make_unique<Queue>());
+            }
+            for (int i = 1; i < threads; i++) {
+                workers.emplace_back([this, i]() {WorkerLoop(i);});
+            }
+        }
+
+        ForkJoinPool(const ForkJoinPool&) = delete;
+        ForkJoinPool& operator=(const ForkJoinPool&) = delete;
+
+        int Threads() const {
+            return (int)queues.size();
+        }
+
+        template <typename A, typename B>
+        void Invoke(A&& a, B&& b) {
+            Task task(std::forward<B>(b));
+            Queue& queue = LocalQueue();
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(&task);
+            }
+            // Под sleepMutex: иначе рабочий, только что увидевший pending == 0 в wait,
+            // может пропустить уведомление и уснуть при непустой очереди.
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                pending.fetch_add(1, std::memory_order_release);
+            }
+            wakeup.notify_one();
+
+            std::exception_ptr error;
+            try {
+                a();
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            bool reclaimed = false;
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty() && queue.tasks.back() == &task) {
+                    queue.tasks.pop_back();
+                    reclaimed = true;
+                }
+            }
+            if (reclaimed) {
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                task.Run();
+            } else {
+                while (!task.done.load(std::memory_order_acquire)) {
+                    if (!RunOne()) std::this_thread::yield();
+                }
+            }
+            if (error) std::rethrow_exception(error);
+            if (task.error) std::rethrow_exception(task.error);
+        }
+
+        // Делит [0, n) на куски не короче grain (не больше восьми на поток), вычисляет
+        // chunk(first, last) для всех кусков параллельно и возвращает результаты по порядку.
+        template <typename R, typename F>
+        std::vector<R> MapChunks(int n, int grain, F&& chunk) {
+            int count = std::clamp(n / std::max(grain, 1), 1, Threads() * 8);
+            std::vector<std::optional<R>> partial(count);
+            auto body = [&](int c) {
+                partial[c].emplace(chunk((int)((long long)n * c / count), (int)((long long)n * (c + 1) / count)));
+            };
+            ForEachIndex(0, count, body);
+            std::vector<R> results;
+            results.reserve(count);
+            for (std::optional<R>& result : partial) results.push_back(std::move(*result));
+            return results;
+        }
+
+        ~ForkJoinPool() {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stop = true;
+            }
+            wakeup.notify_all();
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+        }
+
+    private:
+        struct Task {
+            template <typename F>
+            explicit Task(F&& f) : run(std::forward<F>(f)), done(false) {}
+
+            void Run() {
+                try {
+                    run();
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                done.store(true, std::memory_order_release);
+            }
+
+            std::function<void()> run;
+            std::atomic<bool> done;
+            std::exception_ptr error;
+        };
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task*> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::mutex sleepMutex;
+        std::condition_variable wakeup;
+        bool stop;
+        std::atomic<int> pending;
+
+        static inline thread_local ForkJoinPool* currentPool = nullptr;
+        static inline thread_local int currentIndex = 0;
+
+        // Внешние потоки делят очередь с индексом 0.
+        Queue& LocalQueue() {
+            return *queues[currentPool == this ? currentIndex : 0];
+        }
+
+        Task* TakeOwn(Queue& queue) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) return nullptr;
+            Task* task = queue.tasks.back();
+            queue.tasks.pop_back();
+            return task;
+        }
+
+        Task* Steal(Queue& queue) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) return nullptr;
+            Task* task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return task;
+        }
+
+        template <typename F>
+        void ForEachIndex(int begin, int end, F& body) {
+            if (end - begin == 1) {
+                body(begin);
+                return;
+            }
+            int middle = begin + (end - begin) / 2;
+            Invoke([&]() {ForEachIndex(begin, middle, body);}, [&]() {ForEachIndex(middle, end, body);});
+        }
+
+        bool RunOne() {
+            int own = currentPool == this ? currentIndex : 0;
+            Task* task = TakeOwn(*queues[own]);
+            for (int i = 1; !task && i < (int)queues.size(); i++) {
+                task = Steal(*queues[(own + i) % queues.size()]);
+            }
+            if (!task) return false;
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            task->Run();
+            return true;
+        }
+
+        void WorkerLoop(int index) {
+            currentPool = this;
+            currentIndex = index;
+            while (true) {
+                if (RunOne()) continue;
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wakeup.wait(lock, [this]() {return stop || pending.load(std::memory_order_acquire) > 0;});
+                if (stop) return;
+            }
+        }
+};
+
+#endif // FORKJOINPOOL_HPP
@@ -1,28 +1,38 @@
 #ifndef AVL_HPP
 #define AVL_HPP
 
-#include "../../auxiliary/Stack.hpp"
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include "../../auxiliary/Iterator.hpp"
 #include "Tree.hpp"
-
-enum class BypassType {
-    PreOrder,
-    ReversePreOrder,
-    InOrder,
-    ReverseInOrder,
-    PostOrder,
-    ReversePostOrder
-};
-
-template <typename T>
-class AVL_Tree;
+#include "TreeHelpers.hpp"
+#include "NodeAllocator.hpp"
+#include "PathBuffer.hpp"
+#include "../parallel/ForkJoinPool.hpp"
+#include "FrozenSet.hpp"
 
 template <typename T>
 class Node {
     public:
-        Node(T k, Node<T>* p = nullptr) : key(k), height(1), left(nullptr), right(nullptr), parent(p) {}
+        Node(const T& k, Node<T>* p = nullptr) : key(k), height(1), dead(false), size(1), left(nullptr), right(nullptr), parent(p) {}
+        Node(T&& k, Node<T>* p = nullptr) : key(std::move(k)), height(1), dead(false), size(1), left(nullptr), right(nullptr), parent(p) {}
+        // Ключ строится на месте из args.
+        template <typename... Args>
+        Node(std::in_place_t, Node<T>* p, Args&&... args)
+            : key(std::forward<Args>(args)...), height(1), dead(false), size(1), left(nullptr), right(nullptr), parent(p) {}
         T key;
         unsigned char height;
+        // Узел удалён в ленивом режиме и ждёт уплотнения; size считает только живые узлы.
+        bool dead;
+        int size;
         Node<T>* left;
         Node<T>* right;
         Node<T>* parent;
@@ -37,28 +47,18 @@ class TreeIterator : public IIterator<T, IsConst> {
         using difference_type = typename IIterator<T, IsConst>::difference_type;
         using iterator_category = std::bidirectional_iterator_tag;
 
-        using TreePtr = std::conditional_t<IsConst, const AVL_Tree<T>*, AVL_Tree<T>*>;
-
-        TreeIterator(Node<T>* node, TreePtr t) : current(node), tree(t) {}
+        TreeIterator(Node<T>* node, Node<T>* const* r) : current(node), root(r), successor(node), predecessor(node) {}
 
         bool HasNext() const override {
             if (!current) return false;
-            if (current->right) return true;
-            Node<T>* node = current;
-            while (node->parent && node == node->parent->right) {
-                node = node->parent;
-            }
-            return node->parent != nullptr;
+            if (successor == current) successor = Successor(current);
+            return successor != nullptr;
         }
 
         bool HasPrev() const {
             if (!current) return false;
-            if (current->left) return true;
-            Node<T>* node = current;
-            while (node->parent && node == node->parent->left) {
-                node = node->parent;
-            }
-            return node->parent != nullptr;
+            if (predecessor == current) predecessor = Predecessor(current);
+            return predecessor != nullptr;
         }
 
         reference Current() override {
@@ -114,86 +114,117 @@ class TreeIterator : public IIterator<T, IsConst> {
 
     private:
         Node<T>* current;
-        TreePtr tree;
+        Node<T>* const* root;
+
+        // successor/predecessor == current означает, что сосед ещё не вычислен.
+        mutable Node<T>* successor;
+        mutable Node<T>* predecessor;
 
         void toNext() {
             if (!current) {
                 throw std::out_of_range("Iterator out of range");
             }
-            if (current == tree->FindMax(tree->root)) {
-                current = nullptr;
-                return;
-            }
-            if (current->right) {
-                current = current->right;
-                while (current->left) {
-                    current = current->left;
-                }
-                return;
-            }
-            Node<T>* p = current->parent;
-            while (p && current == p->right) {
-                current = p;
-                p = p->parent;
-            }
-            current = p;
+            current = successor == current ? Successor(current) : successor;
+            successor = predecessor = current;
         }
 
         void toPrev() {
-             if (!current) {
-                if (!tree || !tree->root) {
+            if (!current) {
+                if (!root || !*root) {
                     throw std::out_of_range("Iterator out of range");
                 }
-                current = tree->root;
+                current = *root;
                 while (current->right) {
                     current = current->right;
                 }
-                return;
+                if (current->dead) current = Predecessor(current);
+                if (!current) throw std::out_of_range("Iterator out of range");
+            } else {
+                current = predecessor == current ? Predecessor(current) : predecessor;
             }
-            if (current == tree->FindMin(tree->root)) {
-                current = nullptr;
-                return;
+            successor = predecessor = current;
+        }
+
+        // Соседи по порядку среди живых узлов.
+        static Node<T>* Successor(Node<T>* p) {
+            do {
+                p = Step(p);
+            } while (p && p->dead);
+            return p;
+        }
+
+        static Node<T>* Predecessor(Node<T>* p) {
+            do {
+                p = StepBack(p);
+            } while (p && p->dead);
+            return p;
+        }
+
+        static Node<T>* Step(Node<T>* p) {
+            if (p->right) {
+                p = p->right;
+                while (p->left) {
+                    p = p->left;
+                }
+                return p;
             }
-            if (current->left) {
-                current = current->left;
-                while (current->right) {
-                    current = current->right;
+            while (p->parent && p == p->parent->right) {
+                p = p->parent;
+            }
+            return p->parent;
+        }
+
+        static Node<T>* StepBack(Node<T>* p) {
+            if (p->left) {
+                p = p->left;
+                while (p->right) {
+                    p = p->right;
                 }
-                return;
+                return p;
             }
-            Node<T>* p = current->parent;
-            while (p && current == p->left) {
-                current = p;
+            while (p->parent && p == p->parent->left) {
                 p = p->parent;
             }
-            current = p;
+            return p->parent;
         }
 };
 
-template <typename T>
+// Compare задаёт строгий слабый порядок ключей и должен быть конструируем по умолчанию.
+// Прозрачный Compare (с is_transparent, как std::less<>) разрешает поиск по ключам другого типа.
+template <typename T, typename Compare = std::less<>, template <typename> class Allocator = HeapAllocator>
 class AVL_Tree : public Tree<T>, public IEnumerable<T> {
     public:
         using value_type = T;
         using iterator = TreeIterator<T, false>;
         using const_iterator = TreeIterator<T, true>;
 
+        static constexpr bool IsTransparent = IsTransparentCompare<Compare>;
+
+        template <typename U>
+        using Rebind = AVL_Tree<U, Compare, Allocator>;
+
+        template <typename A, typename B>
+        static int CompareKeys(const A& a, const B& b) {
+            return ThreeWayCompare<Compare>(a, b);
+        }
+
         iterator begin() { 
-            return iterator(FindMin(root), this);
+            return iterator(FirstLive(FindMin(root)), &root);
         }
         iterator end() {
-            return iterator(nullptr, this);
+            return iterator(nullptr, &root);
         }
         const_iterator begin() const {
-            return const_iterator(FindMin(root), this);
+            return const_iterator(FirstLive(FindMin(root)), &root);
         }
         const_iterator end() const {
-            return const_iterator(nullptr, this);
+            return const_iterator(nullptr, &root);
         }
         const_iterator cbegin() const {
-            return const_iterator(FindMin(root), this);
+            return const_iterator(FirstLive(FindMin(root)), &root);
         }
         const_iterator cend() const {
-            return const_iterator(nullptr, this);
+            return const_iterator(nullptr, &root);
         }
 
         std::unique_ptr<IIterator<T, false>> GetIterator() override {
@@ -203,40 +234,64 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
             return std::make_unique<const_iterator>(cbegin());
         }
 
-        AVL_Tree() : root(nullptr), size(0) {}
-        AVL_Tree(const AVL_Tree<T>& other) : root(nullptr), size(0) {
+        AVL_Tree() : root(nullptr), size(0), dead(0), maxDeadFraction(0) {}
+        AVL_Tree(const AVL_Tree& other) : root(nullptr), size(0), dead(0), maxDeadFraction(other.maxDeadFraction) {
             if (other.size < 0) throw std::invalid_argument("Size cannot be negative");
-            Stack<Node<T>*> stack;
-            if (other.root) stack.Push(other.root);
-            while (!stack.IsEmpty()) {
-                Node<T>* current = stack.Top();
-                stack.Pop();
-                this->Insert(current->key);
-                if (current->right) stack.Push(current->right);
-                if (current->left) stack.Push(current->left);
-            }
-        } 
+            allocator.Reserve(other.size + other.dead);
+            root = CloneSubtree(other.root, nullptr);
+            size = other.size;
+            dead = other.dead;
+        }
+
+        AVL_Tree(AVL_Tree&& other) noexcept : root(other.root), size(other.size), dead(other.dead), maxDeadFraction(other.maxDeadFraction) {
+            allocator.Swap(other.allocator);
+            other.root = nullptr;
+            other.size = 0;
+            other.dead = 0;
+        }
+
+        AVL_Tree& operator=(const AVL_Tree& other) {
+            if (this == &other) return *this;
+            Clear();
+            allocator.Reserve(other.size + other.dead);
+            root = CloneSubtree(other.root, nullptr);
+            size = other.size;
+            dead = other.dead;
+            maxDeadFraction = other.maxDeadFraction;
+            return *this;
+        }
+
+        AVL_Tree& operator=(AVL_Tree&& other) noexcept {
+            if (this == &other) return *this;
+            Clear();
+            allocator.Swap(other.allocator);
+            std::swap(root, other.root);
+            std::swap(size, other.size);
+            std::swap(dead, other.dead);
+            maxDeadFraction = other.maxDeadFraction;
+            return *this;
+        }
+
+        template <typename Range>
+        static AVL_Tree* FromSorted(const Range& range) {
+            AVL_Tree* result = new AVL_Tree();
+            auto first = std::begin(range);
+            result->AssignSorted(first, (int)std::distance(first, std::end(range)));
+            return result;
+        }
 
         int Size() const override {
             return size;
         }
 
         T GetMin() const {
-            Node<T>* p = root;
-            if (!root) throw std::out_of_range("Tree is empty");
-            while (p->left) {
-                p = p->left;
-            }
-            return p->key;
+            if (!size) throw std::out_of_range("Tree is empty");
+            return FirstLive(FindMin(root))->key;
         }
 
         T GetMax() const {
-            Node<T>* p = root;
-            if (!root) throw std::out_of_range("Tree is empty");
-            while (p->right) {
-                p = p->right;
-            }
-            return p->key;
+            if (!size) throw std::out_of_range("Tree is empty");
+            return LastLive(FindMax(root))->key;
         }
 
         bool IsEmpty() const {
@@ -244,118 +299,374 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
         }
 
         void Insert(const T& k) override {
-            if (!root) {
-                root = new Node<T>(k, nullptr);
-                size++;
-                return;
-            }
-            Stack<Node<T>**> path;
-            Node<T>** current = &root;
-            Node<T>* parent = nullptr;
-            while (*current) {
-                path.Push(current);
-                parent = *current;
-                if (k < (*current)->key) current = &(*current)->left;
-                else current = &(*current)->right;
-            }
-            *current = new Node<T>(k, parent);
-            while (!path.IsEmpty()) {
-                Node<T>** p = path.Top();
-                path.Pop();
-                *p = Balance(*p);
+            InsertKey<false>(k);
+        }
+
+        void Insert(T&& k) {
+            InsertKey<false>(std::move(k));
+        }
+
+        // Вставка для множеств за один спуск: false, если такой ключ уже есть.
+        bool InsertUnique(const T& k) {
+            return InsertKey<true>(k);
+        }
+
+        bool InsertUnique(T&& k) {
+            return InsertKey<true>(std::move(k));
+        }
+
+        // Ключ строится из args прямо в узле, так что на вставку приходится одно выделение
+        // и ни одного копирования. Возвращает итератор на вставленный ключ.
+        template <typename... Args>
+        iterator Emplace(Args&&... args) {
+            return iterator(LinkNode<false>(allocator.Create(std::in_place, nullptr, std::forward<Args>(args)...)).first, &root);
+        }
+
+        // Если равный ключ уже есть, построенный узел освобождается, а итератор указывает на найденный ключ.
+        template <typename... Args>
+        std::pair<iterator, bool> EmplaceUnique(Args&&... args) {
+            auto [node, inserted] = LinkNode<true>(allocator.Create(std::in_place, nullptr, std::forward<Args>(args)...));
+            return {iterator(node, &root), inserted};
+        }
+
+        // Ищет ключ, равный k, и только если его нет, строит новый из args (он должен быть равен k).
+        // Один спуск и никаких временных объектов, если ключ нашёлся; возвращает итератор
+        // на ключ и признак вставки. Найденный ключ можно менять в частях, не влияющих на порядок.
+        template <typename K, typename... Args> requires (IsTransparent || std::is_same_v<K, T>)
+        std::pair<iterator, bool> FindOrEmplace(const K& k, Args&&... args) {
+            PathBuffer<Node<T>**> path;
+            Node<T>** slot;
+            Node<T>* parent;
+            if (Node<T>* found = FindSlot<true>(k, path, slot, parent)) {
+                if (!found->dead) return {iterator(found, &root), false};
+                if constexpr (std::is_move_assignable_v<T>) {
+                    found->key = T(std::forward<Args>(args)...);
+                } else {
+                    found = ReplaceNode(found, path.Top(), allocator.Create(std::in_place, found->parent, std::forward<Args>(args)...));
+                }
+                Revive(found, path);
+                return {iterator(found, &root), true};
             }
+            Node<T>* node = allocator.Create(std::in_place, parent, std::forward<Args>(args)...);
+            *slot = node;
+            GrowPath(path);
             size++;
-            root = Balance(root);
+            Rebalance(path);
+            return {iterator(node, &root), true};
+        }
+
+        // Вставка пачки: пачка сортируется и сливается с деревом за один проход.
+        // Большая относительно дерева пачка сливается с ним в новый массив и дерево строится заново за O(n + m),
+        // маленькая собирается в поддерево и вливается расщеплениями и склейками за O(m log(n / m + 1)).
+        template <typename Range>
+        void InsertMany(const Range& range) {
+            std::vector<T> batch(std::begin(range), std::end(range));
+            MergeBatch(batch, false);
+        }
+
+        // То же для множеств: ключи, повторяющиеся в пачке или уже лежащие в дереве, пропускаются.
+        template <typename Range>
+        void InsertManyUnique(const Range& range) {
+            std::vector<T> batch(std::begin(range), std::end(range));
+            MergeBatch(batch, true);
         }
 
         bool Remove(const T& k) override {
-            if (!root) return false;
-            Stack<Node<T>**> path;
-            Node<T>** current = &root;
-            Node<T>* parent = nullptr;
-            while (*current && (*current)->key != k) {
-                path.Push(current);
-                parent = *current;
-                if (k < (*current)->key) current = &(*current)->left;
-                else current = &(*current)->right;
+            return maxDeadFraction > 0 ? MarkDead(k) : RemoveKey(k);
+        }
+
+        template <typename K> requires IsTransparent
+        bool Remove(const K& k) {
+            return maxDeadFraction > 0 ? MarkDead(k) : RemoveKey(k);
+        }
+
+        // Удаляет наибольший ключ и возвращает его; из равных наибольших - последний вставленный.
+        // Мёртвые узлы, встреченные справа, освобождаются по пути.
+        T PopMax() {
+            if (!size) throw std::out_of_range("Tree is empty");
+            while (true) {
+                PathBuffer<Node<T>**> path;
+                Node<T>** current = &root;
+                while ((*current)->right) {
+                    path.Push(current);
+                    current = &(*current)->right;
+                }
+                if ((*current)->dead) {
+                    UnlinkRightmost(current, path);
+                    dead--;
+                    continue;
+                }
+                for (int i = 0; i < path.GetSize(); i++) {
+                    (*path[i])->size--;
+                }
+                T result = std::move((*current)->key);
+                UnlinkRightmost(current, path);
+                size--;
+                return result;
             }
-            if (!*current) return false;
-            Node<T>* toDelete = *current;
-            Node<T>* leftChild = toDelete->left;
-            Node<T>* rightChild = toDelete->right;
-            
-            if (!rightChild) {
-                *current = leftChild;
-                if (leftChild) {
-                    leftChild->parent = parent;
+        }
+
+        // Ленивое удаление: Remove только помечает узел мёртвым (O(log n), без поворотов
+        // и освобождения памяти), поиск и обходы такие узлы пропускают, а повторная вставка
+        // того же ключа оживляет узел. Когда мёртвых становится больше maxDeadFraction
+        // от всех узлов, Compact() переподвешивает живые узлы в сбалансированное дерево.
+        // 0 возвращает обычное удаление и сразу уплотняет дерево.
+        void SetLazyRemove(double maxDeadFraction) {
+            if (maxDeadFraction < 0 || maxDeadFraction >= 1) throw std::invalid_argument("Dead fraction must be in [0, 1)");
+            this->maxDeadFraction = maxDeadFraction;
+            if (maxDeadFraction == 0) Compact();
+        }
+
+        int DeadCount() const {
+            return dead;
+        }
+
+        // Освобождает мёртвые узлы и перестраивает дерево из живых за O(n) без новых выделений.
+        void Compact() {
+            if (!dead) return;
+            std::vector<Node<T>*> nodes;
+            nodes.reserve(size);
+            PathBuffer<Node<T>*> stack;
+            Node<T>* current = root;
+            while (current || !stack.IsEmpty()) {
+                while (current) {
+                    stack.Push(current);
+                    current = current->left;
                 }
-            } else {
-                Node<T>* min = FindMin(rightChild);
-                min->right = RemoveMin(rightChild);
-                min->left = leftChild;
-                
-                if (min->right) min->right->parent = min;
-                if (min->left) min->left->parent = min;
-                
-                *current = Balance(min);
-                (*current)->parent = parent;
+                current = stack.Top();
+                stack.Pop();
+                Node<T>* right = current->right;
+                if (current->dead) allocator.Destroy(current);
+                else nodes.push_back(current);
+                current = right;
             }
-            
-            delete toDelete;
-            
-            while (!path.IsEmpty()) {
-                Node<T>** p = path.Top();
-                path.Pop();
-                *p = Balance(*p);
+            root = Relink(nodes.data(), (int)nodes.size(), nullptr);
+            dead = 0;
+        }
+
+        bool Contains(const T& k) const override {
+            return FindNode(k) != nullptr;
+        }
+
+        template <typename K> requires IsTransparent
+        bool Contains(const K& k) const {
+            return FindNode(k) != nullptr;
+        }
+
+        // Пакетный поиск: спуски группы из ProbeGroup ключей продвигаются на уровень за шаг,
+        // а следующий узел каждого спуска заранее запрашивается из памяти, так что промахи перекрываются.
+        void ContainsMany(std::span<const T> keys, std::span<bool> out) const {
+            if (out.size() < keys.size()) throw std::invalid_argument("Result span is too short");
+            ProbeMany(keys, [&out](std::size_t i, Node<T>* node) {out[i] = node != nullptr;});
+        }
+
+        std::vector<iterator> FindMany(std::span<const T> keys) {
+            std::vector<iterator> result;
+            result.reserve(keys.size());
+            ProbeMany(keys, [this, &result](std::size_t, Node<T>* node) {result.emplace_back(node, &root);});
+            return result;
+        }
+        std::vector<const_iterator> FindMany(std::span<const T> keys) const {
+            std::vector<const_iterator> result;
+            result.reserve(keys.size());
+            ProbeMany(keys, [this, &result](std::size_t, Node<T>* node) {result.emplace_back(node, &root);});
+            return result;
+        }
+
+        iterator Find(const T& k) {
+            return iterator(FindNode(k), &root);
+        }
+        const_iterator Find(const T& k) const {
+            return const_iterator(FindNode(k), &root);
+        }
+
+        template <typename K> requires IsTransparent
+        iterator Find(const K& k) {
+            return iterator(FindNode(k), &root);
+        }
+        template <typename K> requires IsTransparent
+        const_iterator Find(const K& k) const {
+            return const_iterator(FindNode(k), &root);
+        }
+
+        // Поиск по границам
+        iterator LowerBound(const T& k) {
+            return iterator(LowerBoundNode(k), &root);
+        }
+        const_iterator LowerBound(const T& k) const {
+            return const_iterator(LowerBoundNode(k), &root);
+        }
+
+        iterator UpperBound(const T& k) {
+            return iterator(UpperBoundNode(k), &root);
+        }
+        const_iterator UpperBound(const T& k) const {
+            return const_iterator(UpperBoundNode(k), &root);
+        }
+
+        template <typename K> requires IsTransparent
+        iterator LowerBound(const K& k) {
+            return iterator(LowerBoundNode(k), &root);
+        }
+        template <typename K> requires IsTransparent
+        const_iterator LowerBound(const K& k) const {
+            return const_iterator(LowerBoundNode(k), &root);
+        }
+
+        template <typename K> requires IsTransparent
+        iterator UpperBound(const K& k) {
+            return iterator(UpperBoundNode(k), &root);
+        }
+        template <typename K> requires IsTransparent
+        const_iterator UpperBound(const K& k) const {
+            return const_iterator(UpperBoundNode(k), &root);
+        }
+
+        iterator Floor(const T& k) {
+            return iterator(FloorNode(k), &root);
+        }
+        const_iterator Floor(const T& k) const {
+            return const_iterator(FloorNode(k), &root);
+        }
+
+        iterator Ceiling(const T& k) {
+            return LowerBound(k);
+        }
+        const_iterator Ceiling(const T& k) const {
+            return LowerBound(k);
+        }
+
+        // Обходит ключи из [lo, hi) по возрастанию за O(log n + k).
+        template <typename F>
+        void ForEachInRange(const T& lo, const T& hi, F&& visit) const {
+            for (Node<T>* p = LowerBoundNode(lo); p && Less(p->key, hi); p = Next(p)) {
+                if (!VisitKey(visit, p->key)) return;
             }
-            
-            if (*current != root) {
-                root = Balance(root);
+        }
+
+        // Порядковые статистики
+        int Rank(const T& k) const {
+            return RankOf(k);
+        }
+
+        template <typename K> requires IsTransparent
+        int Rank(const K& k) const {
+            return RankOf(k);
+        }
+
+        T Select(int index) const {
+            Node<T>* node = SelectNode(index);
+            if (!node) throw std::out_of_range("Index out of range");
+            return node->key;
+        }
+
+        int CountRange(const T& lo, const T& hi) const {
+            int count = Rank(hi) - Rank(lo);
+            return count > 0 ? count : 0;
+        }
+
+        // Операции над множествами. Ключи в обоих деревьях должны быть уникальны;
+        // other не изменяется, его узлы при необходимости копируются.
+        void UnionWith(const AVL_Tree& other) {
+            if (this == &other || !other.root) return;
+            if (WithCompacted(other, [&](const AVL_Tree& compacted) {UnionWith(compacted);})) return;
+            if (!AppendDisjoint(other)) root = UnionNodes(root, other.root);
+            Detach(root);
+            size = SubtreeSize(root);
+        }
+
+        void IntersectWith(const AVL_Tree& other) {
+            if (this == &other) return;
+            if (WithCompacted(other, [&](const AVL_Tree& compacted) {IntersectWith(compacted);})) return;
+            root = Detach(IntersectNodes(root, other.root));
+            size = SubtreeSize(root);
+        }
+
+        void DifferenceWith(const AVL_Tree& other) {
+            if (this == &other) {
+                Clear();
+                return;
             }
-            
-            size--;
-            return true;
+            if (WithCompacted(other, [&](const AVL_Tree& compacted) {DifferenceWith(compacted);})) return;
+            root = Detach(DifferenceNodes(root, other.root));
+            size = SubtreeSize(root);
         }
 
-        bool Contains(const T& k) const override {
-            Node<T>* current = root;
-            while (current) {
-                if (k == current->key) return true;
-                else if (k < current->key) current = current->left;
-                else current = current->right;
+        // Параллельные версии: узлы other сначала копируются, затем оба дерева
+        // рекурсивно делятся по корню большего из них. Лишние узлы освобождаются в конце,
+        // поэтому распределитель используется только из вызывающего потока.
+        void UnionWith(const AVL_Tree& other, ForkJoinPool& pool, int grain = ParallelGrain) {
+            if (this == &other || !other.root) return;
+            if (WithCompacted(other, [&](const AVL_Tree& compacted) {UnionWith(compacted, pool, grain);})) return;
+            if (AppendDisjoint(other)) return;
+            allocator.Reserve(other.size);
+            Node<T>* copy = CloneSubtree(other.root, nullptr);
+            Garbage garbage;
+            root = Detach(UnionOwned(root, copy, garbage, &pool, grain));
+            FreeGarbage(garbage);
+            size = SubtreeSize(root);
+        }
+
+        void IntersectWith(const AVL_Tree& other, ForkJoinPool& pool, int grain = ParallelGrain) {
+            if (this == &other) return;
+            if (WithCompacted(other, [&](const AVL_Tree& compacted) {IntersectWith(compacted, pool, grain);})) return;
+            allocator.Reserve(other.size);
+            Node<T>* copy = CloneSubtree(other.root, nullptr);
+            Garbage garbage;
+            root = Detach(IntersectOwned(root, copy, garbage, &pool, grain));
+            FreeGarbage(garbage);
+            size = SubtreeSize(root);
+        }
+
+        void DifferenceWith(const AVL_Tree& other, ForkJoinPool& pool, int grain = ParallelGrain) {
+            if (this == &other) {
+                Clear();
+                return;
             }
-            return false;
+            if (WithCompacted(other, [&](const AVL_Tree& compacted) {DifferenceWith(compacted, pool, grain);})) return;
+            allocator.Reserve(other.size);
+            Node<T>* copy = CloneSubtree(other.root, nullptr);
+            Garbage garbage;
+            root = Detach(DifferenceOwned(root, copy, garbage, &pool, grain));
+            FreeGarbage(garbage);
+            size = SubtreeSize(root);
         }
 
-        // Обходы
-        void PreOrder(std::function<void(const T&)> visit) const override { // КЛП
-            Stack<Node<T>*> stack;
+        // Обходы. Посетитель может вернуть VisitResult::Stop, тогда обход прерывается
+        // и функция возвращает false.
+        template <typename F>
+        bool PreOrder(F&& visit) const { // КЛП
+            PathBuffer<Node<T>*> stack;
             if (root) stack.Push(root);
 
             while (!stack.IsEmpty()) {
                 Node<T>* current = stack.Top();
                 stack.Pop();
-                visit(current->key);
+                if (!current->dead && !VisitKey(visit, current->key)) return false;
                 if (current->right) stack.Push(current->right);
                 if (current->left) stack.Push(current->left);
             }
+            return true;
         }
 
-        void ReversePreOrder(std::function<void(const T&)> visit) const override { // КПЛ
-            Stack<Node<T>*> stack;
+        template <typename F>
+        bool ReversePreOrder(F&& visit) const { // КПЛ
+            PathBuffer<Node<T>*> stack;
             if (root) stack.Push(root);
 
             while (!stack.IsEmpty()) {
                 Node<T>* current = stack.Top();
                 stack.Pop();
-                visit(current->key);
+                if (!current->dead && !VisitKey(visit, current->key)) return false;
                 if (current->left) stack.Push(current->left);
                 if (current->right) stack.Push(current->right);
             }
+            return true;
         }
 
-        void InOrder(std::function<void(const T&)> visit) const override { // ЛКП
-            Stack<Node<T>*> stack;
+        template <typename F>
+        bool InOrder(F&& visit) const { // ЛКП
+            PathBuffer<Node<T>*> stack;
             Node<T>* current = root;
 
             while (current || !stack.IsEmpty()) {
@@ -365,13 +676,15 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
                 }
                 current = stack.Top();
                 stack.Pop();
-                visit(current->key);
+                if (!current->dead && !VisitKey(visit, current->key)) return false;
                 current = current->right;
             }
+            return true;
         }
 
-        void ReverseInOrder(std::function<void(const T&)> visit) const override { // ПКЛ
-            Stack<Node<T>*> stack;
+        template <typename F>
+        bool ReverseInOrder(F&& visit) const { // ПКЛ
+            PathBuffer<Node<T>*> stack;
             Node<T>* current = root;
 
             while (current || !stack.IsEmpty()) {
@@ -381,13 +694,15 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
                 }
                 current = stack.Top();
                 stack.Pop();
-                visit(current->key);
+                if (!current->dead && !VisitKey(visit, current->key)) return false;
                 current = current->left;
             }
+            return true;
         }
 
-        void PostOrder(std::function<void(const T&)> visit) const override { // ЛПК
-            Stack<Node<T>*> stack;
+        template <typename F>
+        bool PostOrder(F&& visit) const { // ЛПК
+            PathBuffer<Node<T>*> stack;
             Node<T>* current = root;
             Node<T>* lastVisited = nullptr;
 
@@ -400,16 +715,18 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
                     if (peek->right && lastVisited != peek->right) {
                         current = peek->right;
                     } else {
-                        visit(peek->key);
+                        if (!peek->dead && !VisitKey(visit, peek->key)) return false;
                         lastVisited = peek;
                         stack.Pop();
                     }
                 }
             }
+            return true;
         }
 
-        void ReversePostOrder(std::function<void(const T&)> visit) const override { // ПЛК
-            Stack<Node<T>*> stack;
+        template <typename F>
+        bool ReversePostOrder(F&& visit) const { // ПЛК
+            PathBuffer<Node<T>*> stack;
             Node<T>* current = root;
             Node<T>* lastVisited = nullptr;
 
@@ -422,58 +739,121 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
                     if (peek->left && lastVisited != peek->left) {
                         current = peek->left;
                     } else {
-                        visit(peek->key);
+                        if (!peek->dead && !VisitKey(visit, peek->key)) return false;
                         lastVisited = peek;
                         stack.Pop();
                     }
                 }
             }
+            return true;
+        }
+
+        // Точки входа Tree<T> для вызова через базовый класс; внутри дерева используются шаблонные обходы.
+        void PreOrder(std::function<void(const T&)> visit) const override {
+            PreOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReversePreOrder(std::function<void(const T&)> visit) const override {
+            ReversePreOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void InOrder(std::function<void(const T&)> visit) const override {
+            InOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReverseInOrder(std::function<void(const T&)> visit) const override {
+            ReverseInOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void PostOrder(std::function<void(const T&)> visit) const override {
+            PostOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReversePostOrder(std::function<void(const T&)> visit) const override {
+            ReversePostOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        bool Traverse(BypassType order, std::function<VisitResult(const T&)> visit) const override {
+            return Traverse<std::function<VisitResult(const T&)>&>(order, visit);
         }
 
-        AVL_Tree<T>* GetSubTree(const T& k) const override {
-            AVL_Tree<T>* result = new AVL_Tree<T>();
-            Node<T>* Actual_Node = root;
-            while (Actual_Node) {
-                if (k == Actual_Node->key) break;
-                else if (k < Actual_Node->key) Actual_Node = Actual_Node->left;
-                else Actual_Node = Actual_Node->right;
+        template <typename F>
+        bool Traverse(BypassType order, F&& visit) const {
+            switch (order) {
+                case BypassType::PreOrder : return PreOrder(visit);
+                case BypassType::ReversePreOrder : return ReversePreOrder(visit);
+                case BypassType::InOrder : return InOrder(visit);
+                case BypassType::ReverseInOrder : return ReverseInOrder(visit);
+                case BypassType::PostOrder : return PostOrder(visit);
+                case BypassType::ReversePostOrder : return ReversePostOrder(visit);
+                default:
+                    throw std::invalid_argument("Unknown Bypass type");
             }
+        }
+
+        AVL_Tree* GetSubTree(const T& k) const override {
+            AVL_Tree* result = new AVL_Tree();
+            Node<T>* Actual_Node = FindNode(k);
             if (!Actual_Node) return result;
-            Stack<Node<T>*> stack;
-            stack.Push(Actual_Node);
-            while (!stack.IsEmpty()) {
-                Node<T>* current = stack.Top();
-                stack.Pop();
-                result->Insert(current->key);
-                if (current->right) stack.Push(current->right);
-                if (current->left) stack.Push(current->left);
+            if (dead) {
+                std::vector<T> values;
+                values.reserve(Actual_Node->size);
+                auto collect = [&values](Node<T>* p) {values.push_back(p->key);};
+                VisitRankRange(Actual_Node, 0, 0, Actual_Node->size, collect);
+                result->AssignSorted(values.cbegin(), (int)values.size());
+                return result;
             }
+            result->allocator.Reserve(Actual_Node->size);
+            result->root = result->CloneSubtree(Actual_Node, nullptr);
+            result->size = Actual_Node->size;
             return result;
         }
 
-        AVL_Tree<T>* Concat(Tree<T>* other) const override {
-            AVL_Tree<T>* result = new AVL_Tree<T>(*this);
-            if (dynamic_cast<AVL_Tree<T>*>(other)->size <= 0 || !dynamic_cast<AVL_Tree<T>*>(other)->root) return result;
-            Stack<Node<T>*> stack;
-            if (dynamic_cast<AVL_Tree<T>*>(other)->root) stack.Push(dynamic_cast<AVL_Tree<T>*>(other)->root);
-            while (!stack.IsEmpty()) {
-                Node<T>* current = stack.Top();
-                stack.Pop();
-                result->Insert(current->key);
-                if (current->right) stack.Push(current->right);
-                if (current->left) stack.Push(current->left);
+        AVL_Tree* Concat(Tree<T>* other) const override {
+            AVL_Tree* tree = dynamic_cast<AVL_Tree*>(other);
+            if (!tree) {
+                AVL_Tree* result = new AVL_Tree(*this);
+                other->PreOrder([result](const T& value) {result->Insert(value);});
+                return result;
             }
+            if (!dead && !tree->dead && root && tree->root && (!Less(tree->GetMin(), GetMax()) || !Less(GetMin(), tree->GetMax()))) {
+                AVL_Tree* result = new AVL_Tree(*this);
+                result->AppendDisjoint(*tree);
+                return result;
+            }
+            std::vector<T> values;
+            values.reserve(size + tree->size);
+            std::merge(cbegin(), cend(), tree->cbegin(), tree->cend(), std::back_inserter(values), Compare{});
+            return FromSorted(values);
+        }
+
+        // Параллельная версия: деревья делятся по корню большего из них, пока поддеревья не станут меньше grain.
+        AVL_Tree* Concat(Tree<T>* other, ForkJoinPool& pool, int grain = ParallelGrain) const {
+            AVL_Tree* tree = dynamic_cast<AVL_Tree*>(other);
+            if (!tree || dead || tree->dead) return Concat(other);
+            AVL_Tree* result = new AVL_Tree(*this);
+            if (!tree->root) return result;
+            result->allocator.Reserve(tree->size);
+            Node<T>* copy = result->CloneSubtree(tree->root, nullptr);
+            result->root = Detach(result->MergeOwned(result->root, copy, &pool, grain));
+            result->size = SubtreeSize(result->root);
             return result;
         }
 
-        AVL_Tree<T>* Clutch(Tree<T>* other) override {
-            if (dynamic_cast<AVL_Tree<T>*>(other)->size <= 0 || !dynamic_cast<AVL_Tree<T>*>(other)->root) return this;
-            Stack<Node<T>*> stack;
-            if (dynamic_cast<AVL_Tree<T>*>(other)->root) stack.Push(dynamic_cast<AVL_Tree<T>*>(other)->root);
+        AVL_Tree* Clutch(Tree<T>* other) override {
+            AVL_Tree* tree = dynamic_cast<AVL_Tree*>(other);
+            if (!tree) {
+                other->PreOrder([this](const T& value) {this->Insert(value);});
+                return this;
+            }
+            if (tree->size <= 0 || !tree->root) return this;
+            if (AppendDisjoint(*tree)) return this;
+            PathBuffer<Node<T>*> stack;
+            stack.Push(tree->root);
             while (!stack.IsEmpty()) {
                 Node<T>* current = stack.Top();
                 stack.Pop();
-                this->Insert(current->key);
+                if (!current->dead) this->Insert(current->key);
                 if (current->right) stack.Push(current->right);
                 if (current->left) stack.Push(current->left);
             }
@@ -481,113 +861,188 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
         }
 
         template <typename U>
-        AVL_Tree<U>* Map(std::function<U(T)> f) const {
-            AVL_Tree<U>* result = new AVL_Tree<U>();
-            if (!root || size <= 0) return result;
+        AVL_Tree<U, Compare, Allocator>* Map(std::function<U(T)> f) const {
+            std::vector<U> values;
+            values.reserve(size);
+            InOrder([&values, &f](const T& value) {values.push_back(f(value));});
+            std::stable_sort(values.begin(), values.end(), Compare{});
+            return AVL_Tree<U, Compare, Allocator>::FromSorted(values);
+        }
 
-            Stack<Node<T>*> stack;
-            if (root) stack.Push(root);
+        AVL_Tree* Where(std::function<bool(T)> f) const {
+            std::vector<T> values;
+            InOrder([&values, &f](const T& value) {
+                if (f(value)) values.push_back(value);
+            });
+            return FromSorted(values);
+        }
 
-            while (!stack.IsEmpty()) {
-                Node<T>* current = stack.Top();
-                stack.Pop();
-                result->Insert(f(current->key));
-                if (current->right) stack.Push(current->right);
-                if (current->left) stack.Push(current->left);
-            }
-            return result;
+        // Параллельные версии: ключи делятся по порядковым номерам на куски, которые
+        // обходятся в пуле независимо, а результаты кусков склеиваются по порядку.
+        // Дерево строится в вызывающем потоке, как и в параллельных операциях над множествами.
+        template <typename U>
+        AVL_Tree<U, Compare, Allocator>* Map(std::function<U(T)> f, ForkJoinPool& pool, int grain = ParallelGrain) const {
+            std::vector<U> values = Collect<U>([&f](const T& value, std::vector<U>& out) {out.push_back(f(value));}, pool, grain);
+            if (!std::is_sorted(values.begin(), values.end(), Compare{})) std::stable_sort(values.begin(), values.end(), Compare{});
+            return AVL_Tree<U, Compare, Allocator>::FromSorted(values);
         }
 
-        AVL_Tree<T>* Where(std::function<bool(T)> f) const {
-            AVL_Tree<T>* result = new AVL_Tree<T>();
-            if (!root || size <= 0) return result;
-            
-            Stack<Node<T>*> stack;
-            if (root) stack.Push(root);
+        AVL_Tree* Where(std::function<bool(T)> f, ForkJoinPool& pool, int grain = ParallelGrain) const {
+            std::vector<T> values = Collect<T>([&f](const T& value, std::vector<T>& out) {
+                if (f(value)) out.push_back(value);
+            }, pool, grain);
+            return FromSorted(values);
+        }
 
-            while (!stack.IsEmpty()) {
-                Node<T>* current = stack.Top();
-                stack.Pop();
-                if (f(current->key)) result->Insert(current->key);
-                if (current->right) stack.Push(current->right);
-                if (current->left) stack.Push(current->left);
-            }
+        // f должна быть ассоциативной, а identity - её нейтральным элементом;
+        // порядок аргументов сохраняется, так что коммутативность не нужна.
+        T Reduce(std::function<T(T, T)> f, const T& identity, ForkJoinPool& pool, int grain = ParallelGrain) const {
+            std::vector<T> partial = pool.MapChunks<T>(size, grain, [this, &f, &identity](int first, int last) {
+                T result = identity;
+                auto fold = [&result, &f](Node<T>* p) {result = f(result, p->key);};
+                VisitRankRange(root, 0, first, last, fold);
+                return result;
+            });
+            T result = identity;
+            for (const T& value : partial) result = f(result, value);
             return result;
         }
 
-        static AVL_Tree<T>* fromString(const std::string& data) {
-            AVL_Tree<T>* result = new AVL_Tree<T>();
-            std::istringstream iss(data);
+        // Вызывает emit(key, out) для всех ключей по возрастанию, раздав куски пулу;
+        // out - вектор куска, куски склеиваются по порядку.
+        template <typename U, typename F>
+        std::vector<U> Collect(F&& emit, ForkJoinPool& pool, int grain = ParallelGrain) const {
+            std::vector<std::vector<U>> parts = pool.MapChunks<std::vector<U>>(size, grain, [this, &emit](int first, int last) {
+                std::vector<U> out;
+                auto visit = [&out, &emit](Node<T>* p) {emit(p->key, out);};
+                VisitRankRange(root, 0, first, last, visit);
+                return out;
+            });
+            std::size_t total = 0;
+            for (const std::vector<U>& part : parts) total += part.size();
+            std::vector<U> values;
+            values.reserve(total);
+            for (std::vector<U>& part : parts) std::move(part.begin(), part.end(), std::back_inserter(values));
+            return values;
+        }
+
+        // Первые limit подходящих элементов; обход останавливается на последнем из них.
+        AVL_Tree* Where(std::function<bool(T)> f, int limit) const {
+            std::vector<T> values;
+            if (limit > 0) {
+                InOrder([&values, &f, limit](const T& value) {
+                    if (f(value)) values.push_back(value);
+                    return (int)values.size() < limit ? VisitResult::Continue : VisitResult::Stop;
+                });
+            }
+            return FromSorted(values);
+        }
+
+        // Наибольший префикс (в порядке возрастания), все элементы которого удовлетворяют f.
+        AVL_Tree* TakeWhile(std::function<bool(T)> f) const {
+            std::vector<T> values;
+            InOrder([&values, &f](const T& value) {
+                if (!f(value)) return VisitResult::Stop;
+                values.push_back(value);
+                return VisitResult::Continue;
+            });
+            return FromSorted(values);
+        }
+
+        // Наименьший элемент, удовлетворяющий pred, или end().
+        template <typename F>
+        iterator FindFirst(F&& pred) {
+            iterator it = begin();
+            while (it != end() && !pred(*it)) ++it;
+            return it;
+        }
+        template <typename F>
+        const_iterator FindFirst(F&& pred) const {
+            const_iterator it = cbegin();
+            while (it != cend() && !pred(*it)) ++it;
+            return it;
+        }
+
+        // Неизменяемый снимок для чтения; повторяющиеся ключи схлопываются в один.
+        FrozenSet<T, Compare>* Freeze() const {
+            return FrozenSet<T, Compare>::FromSorted(*this);
+        }
+
+        static AVL_Tree* fromString(const std::string& data) {
+            std::vector<T> values;
+            std::istringstream iss(data);
             char c;
             T value;
             if (iss >> value) {
-                result->Insert(value);
+                values.push_back(value);
                 while (iss >> c >> value) {
                     if (c != ',') break;
-                    result->Insert(value);
+                    values.push_back(value);
                 }
             }
-            return result;
+            if (!std::is_sorted(values.begin(), values.end(), Compare{})) std::stable_sort(values.begin(), values.end(), Compare{});
+            return FromSorted(values);
         }
 
         std::string toString(BypassType order = BypassType::InOrder) const {
             std::ostringstream oss;
-            switch (order) {
-                case BypassType::PreOrder : {
-                    PreOrder([&oss](const T& value) {oss << value << " ";});
-                    break;
-                }
-                case BypassType::ReversePreOrder : {
-                    ReversePreOrder([&oss](const T& value) {oss << value << " ";});
-                    break;
-                }
-                case BypassType::InOrder : {
-                    InOrder([&oss](const T& value) {oss << value << " ";});
-                    break;
-                }
-                case BypassType::ReverseInOrder : {
-                    ReverseInOrder([&oss](const T& value) {oss << value << " ";});
-                    break;
-                }
-                case BypassType::PostOrder : {
-                    PostOrder([&oss](const T& value) {oss << value << " ";});
-                    break;
-                }
-                case BypassType::ReversePostOrder : {
-                    ReversePostOrder([&oss](const T& value) {oss << value << " ";});
-                    break;
-                }
-                default:
-                    throw std::invalid_argument("Unknown Bypass type");
-            }
+            Traverse(order, [&oss](const T& value) {oss << value << " ";});
             return oss.str();
         }
 
         void Clear() override {
             if (!root) return;
-            Stack<Node<T>*> stack;
-            stack.Push(root);
-            while (!stack.IsEmpty()) {
-                Node<T>* current = stack.Top();
-                stack.Pop();
-                if (current->left) stack.Push(current->left);
-                if (current->right) stack.Push(current->right);
-                delete current;
+            if constexpr (Allocator<Node<T>>::BulkRelease && std::is_trivially_destructible_v<T>) {
+                allocator.Release();
+                root = nullptr;
+                size = dead = 0;
+                return;
             }
+            DestroySubtree(root);
+            allocator.Release();
             root = nullptr;
-            size = 0;
+            size = dead = 0;
         }
 
         ~AVL_Tree() override { 
             Clear();
         }
 
+        static constexpr int ParallelGrain = 1 << 13;
+
     private:
         Node<T>* root;
         int size;
+        int dead;
+        double maxDeadFraction;
+        Allocator<Node<T>> allocator;
+
+        // Отложенное освобождение: корни выброшенных поддеревьев связаны через parent.
+        struct Garbage {
+            Node<T>* head = nullptr;
+            Node<T>* tail = nullptr;
+
+            void Add(Node<T>* p) {
+                if (!p) return;
+                p->parent = nullptr;
+                if (tail) tail->parent = p;
+                else head = p;
+                tail = p;
+            }
+
+            void AddNode(Node<T>* p) {
+                p->left = nullptr;
+                p->right = nullptr;
+                Add(p);
+            }
 
-        template <typename U, bool IsConst>
-        friend class TreeIterator;
+            void Append(const Garbage& other) {
+                if (!other.head) return;
+                if (tail) tail->parent = other.head;
+                else head = other.head;
+                tail = other.tail;
+            }
+        };
 
         void UpdateParent(Node<T>* node, Node<T>* newParent) {
             if (node == root) node->parent = nullptr;
@@ -604,10 +1059,15 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
             return Height(p->right) - Height(p->left);
         }
 
+        static int SubtreeSize(Node<T>* p) {
+            return p ? p->size : 0;
+        }
+
         void FixHeight(Node<T>* p) {
             unsigned char hl = Height(p->left);
             unsigned char hr = Height(p->right);
             p->height = (hl > hr ? hl : hr) + 1;
+            p->size = SubtreeSize(p->left) + SubtreeSize(p->right) + !p->dead;
         }
 
         Node<T>* RotateRight(Node<T>* p) {
@@ -647,31 +1107,800 @@ class AVL_Tree : public Tree<T>, public IEnumerable<T> {
             return p;
         }
 
-        Node<T>* RemoveMin(Node<T>* p) {
-            if (!p->left) {
-                if (p->right) {
-                    p->right->parent = p->parent;
-                }
-                return p->right;
+        void Rebalance(PathBuffer<Node<T>**>& path) {
+            while (!path.IsEmpty()) {
+                Node<T>** p = path.Top();
+                path.Pop();
+                unsigned char height = (*p)->height;
+                *p = Balance(*p);
+                if ((*p)->height == height) break;
+            }
+        }
+
+        void DestroySubtree(Node<T>* p) {
+            if (!p) return;
+            PathBuffer<Node<T>*> stack;
+            stack.Push(p);
+            while (!stack.IsEmpty()) {
+                Node<T>* current = stack.Top();
+                stack.Pop();
+                if (current->left) stack.Push(current->left);
+                if (current->right) stack.Push(current->right);
+                allocator.Destroy(current);
+            }
+        }
+
+        // Соединение и разрез. Возвращаемые корни всегда имеют parent == nullptr.
+        static Node<T>* Detach(Node<T>* p) {
+            if (p) p->parent = nullptr;
+            return p;
+        }
+
+        void Link(Node<T>* mid, Node<T>* left, Node<T>* right) {
+            mid->left = left;
+            mid->right = right;
+            if (left) left->parent = mid;
+            if (right) right->parent = mid;
+            FixHeight(mid);
+        }
+
+        Node<T>* Join(Node<T>* left, Node<T>* mid, Node<T>* right) {
+            if (Height(left) > Height(right) + 1) return Detach(JoinRight(left, mid, right));
+            if (Height(right) > Height(left) + 1) return Detach(JoinLeft(left, mid, right));
+            Link(mid, left, right);
+            return Detach(mid);
+        }
+
+        Node<T>* JoinRight(Node<T>* left, Node<T>* mid, Node<T>* right) {
+            if (Height(left) <= Height(right) + 1) {
+                Link(mid, left, right);
+                return mid;
+            }
+            Node<T>* r = JoinRight(left->right, mid, right);
+            left->right = r;
+            r->parent = left;
+            return Balance(left);
+        }
+
+        Node<T>* JoinLeft(Node<T>* left, Node<T>* mid, Node<T>* right) {
+            if (Height(right) <= Height(left) + 1) {
+                Link(mid, left, right);
+                return mid;
+            }
+            Node<T>* l = JoinLeft(left, mid, right->left);
+            right->left = l;
+            l->parent = right;
+            return Balance(right);
+        }
+
+        Node<T>* Join2(Node<T>* left, Node<T>* right) {
+            if (!left) return Detach(right);
+            if (!right) return Detach(left);
+            Node<T>* min;
+            Node<T>* rest = SplitMin(right, min);
+            return Join(left, min, rest);
+        }
+
+        Node<T>* SplitMin(Node<T>* t, Node<T>*& min) {
+            if (!t->left) {
+                min = t;
+                return Detach(t->right);
             }
-            Stack<Node<T>**> path;
-            Node<T>** current = &p;
-            Node<T>* parent = p->parent;
-            while ((*current)->left) {
+            Node<T>* rest = SplitMin(t->left, min);
+            return Join(rest, t, t->right);
+        }
+
+        void Split(Node<T>* t, const T& k, Node<T>*& left, Node<T>*& found, Node<T>*& right) {
+            if (!t) {
+                left = found = right = nullptr;
+                return;
+            }
+            Node<T>* l = t->left;
+            Node<T>* r = t->right;
+            Node<T>* middle;
+            int order = CompareKeys(k, t->key);
+            if (order == 0) {
+                left = Detach(l);
+                right = Detach(r);
+                Link(t, nullptr, nullptr);
+                found = Detach(t);
+            } else if (order < 0) {
+                Split(l, k, left, found, middle);
+                right = Join(middle, t, r);
+            } else {
+                Split(r, k, middle, found, right);
+                left = Join(l, t, middle);
+            }
+        }
+
+        Node<T>* UnionNodes(Node<T>* a, const Node<T>* b) {
+            if (!b) return a;
+            if (!a) return CloneSubtree(b, nullptr);
+            Node<T>* l;
+            Node<T>* found;
+            Node<T>* r;
+            Split(a, b->key, l, found, r);
+            Node<T>* left = UnionNodes(l, b->left);
+            Node<T>* right = UnionNodes(r, b->right);
+            if (!found) found = allocator.Create(b->key);
+            return Join(left, found, right);
+        }
+
+        Node<T>* IntersectNodes(Node<T>* a, const Node<T>* b) {
+            if (!a) return nullptr;
+            if (!b) {
+                DestroySubtree(a);
+                return nullptr;
+            }
+            Node<T>* l;
+            Node<T>* found;
+            Node<T>* r;
+            Split(a, b->key, l, found, r);
+            Node<T>* left = IntersectNodes(l, b->left);
+            Node<T>* right = IntersectNodes(r, b->right);
+            if (found) return Join(left, found, right);
+            return Join2(left, right);
+        }
+
+        Node<T>* DifferenceNodes(Node<T>* a, const Node<T>* b) {
+            if (!a || !b) return a;
+            Node<T>* l;
+            Node<T>* found;
+            Node<T>* r;
+            Split(a, b->key, l, found, r);
+            Node<T>* left = DifferenceNodes(l, b->left);
+            Node<T>* right = DifferenceNodes(r, b->right);
+            if (found) allocator.Destroy(found);
+            return Join2(left, right);
+        }
+
+        void FreeGarbage(Garbage& garbage) {
+            Node<T>* current = garbage.head;
+            while (current) {
+                Node<T>* next = current->parent;
+                DestroySubtree(current);
+                current = next;
+            }
+            garbage.head = garbage.tail = nullptr;
+        }
+
+        template <typename A, typename B>
+        static void Fork(ForkJoinPool* pool, int work, int grain, A&& a, B&& b) {
+            if (pool && work > grain) {
+                pool->Invoke(a, b);
+            } else {
+                a();
+                b();
+            }
+        }
+
+        void SplitLess(Node<T>* t, const T& k, Node<T>*& left, Node<T>*& right) {
+            if (!t) {
+                left = right = nullptr;
+                return;
+            }
+            Node<T>* l = t->left;
+            Node<T>* r = t->right;
+            Node<T>* middle;
+            if (Less(t->key, k)) {
+                SplitLess(r, k, middle, right);
+                left = Join(l, t, middle);
+            } else {
+                SplitLess(l, k, left, middle);
+                right = Join(middle, t, r);
+            }
+        }
+
+        // Рекурсии над двумя деревьями, узлы которых принадлежат этому дереву.
+        Node<T>* UnionOwned(Node<T>* a, Node<T>* b, Garbage& garbage, ForkJoinPool* pool, int grain) {
+            if (!a) return b;
+            if (!b) return a;
+            if (SubtreeSize(a) < SubtreeSize(b)) std::swap(a, b);
+            int work = SubtreeSize(a) + SubtreeSize(b);
+            Node<T>* al = a->left;
+            Node<T>* ar = a->right;
+            Node<T>* l;
+            Node<T>* found;
+            Node<T>* r;
+            Split(b, a->key, l, found, r);
+            if (found) garbage.AddNode(found);
+            Node<T>* left;
+            Node<T>* right;
+            Garbage rightGarbage;
+            Fork(pool, work, grain,
+                [&]() {left = UnionOwned(al, l, garbage, pool, grain);},
+                [&]() {right = UnionOwned(ar, r, rightGarbage, pool, grain);});
+            garbage.Append(rightGarbage);
+            return Join(left, a, right);
+        }
+
+        Node<T>* IntersectOwned(Node<T>* a, Node<T>* b, Garbage& garbage, ForkJoinPool* pool, int grain) {
+            if (!a || !b) {
+                garbage.Add(a);
+                garbage.Add(b);
+                return nullptr;
+            }
+            if (SubtreeSize(a) < SubtreeSize(b)) std::swap(a, b);
+            int work = SubtreeSize(a) + SubtreeSize(b);
+            Node<T>* al = a->left;
+            Node<T>* ar = a->right;
+            Node<T>* l;
+            Node<T>* found;
+            Node<T>* r;
+            Split(b, a->key, l, found, r);
+            Node<T>* left;
+            Node<T>* right;
+            Garbage rightGarbage;
+            Fork(pool, work, grain,
+                [&]() {left = IntersectOwned(al, l, garbage, pool, grain);},
+                [&]() {right = IntersectOwned(ar, r, rightGarbage, pool, grain);});
+            garbage.Append(rightGarbage);
+            if (found) {
+                garbage.AddNode(found);
+                return Join(left, a, right);
+            }
+            garbage.AddNode(a);
+            return Join2(left, right);
+        }
+
+        Node<T>* DifferenceOwned(Node<T>* a, Node<T>* b, Garbage& garbage, ForkJoinPool* pool, int grain) {
+            if (!a) {
+                garbage.Add(b);
+                return nullptr;
+            }
+            if (!b) return a;
+            int work = SubtreeSize(a) + SubtreeSize(b);
+            Node<T>* l;
+            Node<T>* found;
+            Node<T>* r;
+            Node<T>* left;
+            Node<T>* right;
+            Garbage rightGarbage;
+            if (SubtreeSize(a) >= SubtreeSize(b)) {
+                Node<T>* al = a->left;
+                Node<T>* ar = a->right;
+                Split(b, a->key, l, found, r);
+                Fork(pool, work, grain,
+                    [&]() {left = DifferenceOwned(al, l, garbage, pool, grain);},
+                    [&]() {right = DifferenceOwned(ar, r, rightGarbage, pool, grain);});
+                garbage.Append(rightGarbage);
+                if (!found) return Join(left, a, right);
+                garbage.AddNode(found);
+                garbage.AddNode(a);
+                return Join2(left, right);
+            }
+            Node<T>* bl = b->left;
+            Node<T>* br = b->right;
+            Split(a, b->key, l, found, r);
+            Fork(pool, work, grain,
+                [&]() {left = DifferenceOwned(l, bl, garbage, pool, grain);},
+                [&]() {right = DifferenceOwned(r, br, rightGarbage, pool, grain);});
+            garbage.Append(rightGarbage);
+            garbage.AddNode(b);
+            if (found) garbage.AddNode(found);
+            return Join2(left, right);
+        }
+
+        Node<T>* MergeOwned(Node<T>* a, Node<T>* b, ForkJoinPool* pool, int grain) {
+            if (!a) return b;
+            if (!b) return a;
+            if (SubtreeSize(a) < SubtreeSize(b)) std::swap(a, b);
+            int work = SubtreeSize(a) + SubtreeSize(b);
+            Node<T>* al = a->left;
+            Node<T>* ar = a->right;
+            Node<T>* l;
+            Node<T>* r;
+            SplitLess(b, a->key, l, r);
+            Node<T>* left;
+            Node<T>* right;
+            Fork(pool, work, grain,
+                [&]() {left = MergeOwned(al, l, pool, grain);},
+                [&]() {right = MergeOwned(ar, r, pool, grain);});
+            return Join(left, a, right);
+        }
+
+        // Если диапазоны ключей не пересекаются, other приклеивается за O(log n) после копирования его узлов.
+        bool AppendDisjoint(const AVL_Tree& other) {
+            if (!root || !other.root || dead || other.dead) return false;
+            if (!Less(other.GetMin(), GetMax())) {
+                allocator.Reserve(other.size);
+                root = Join2(root, CloneSubtree(other.root, nullptr));
+            } else if (!Less(GetMin(), other.GetMax())) {
+                allocator.Reserve(other.size);
+                root = Join2(CloneSubtree(other.root, nullptr), root);
+            } else {
+                return false;
+            }
+            size = SubtreeSize(root);
+            return true;
+        }
+
+        Node<T>* CloneSubtree(const Node<T>* p, Node<T>* parent) {
+            if (!p) return nullptr;
+            Node<T>* node = allocator.Create(p->key, parent);
+            node->height = p->height;
+            node->dead = p->dead;
+            node->size = p->size;
+            node->left = CloneSubtree(p->left, node);
+            node->right = CloneSubtree(p->right, node);
+            return node;
+        }
+
+        template <typename It>
+        Node<T>* BuildSorted(It& it, int count) {
+            if (count <= 0) return nullptr;
+            Node<T>* left = BuildSorted(it, count / 2);
+            Node<T>* node = allocator.Create(*it);
+            ++it;
+            Node<T>* right = BuildSorted(it, count - count / 2 - 1);
+            node->left = left;
+            node->right = right;
+            if (left) left->parent = node;
+            if (right) right->parent = node;
+            FixHeight(node);
+            return node;
+        }
+
+        template <typename It>
+        void AssignSorted(It first, int count) {
+            Clear();
+            allocator.Reserve(count);
+            root = BuildSorted(first, count);
+            size = count;
+        }
+
+        // Во сколько раз дерево может превосходить пачку, чтобы её ещё выгодно было сливать перестройкой.
+        static constexpr int RebuildRatio = 4;
+
+        void MergeBatch(std::vector<T>& batch, bool unique) {
+            if (!std::is_sorted(batch.begin(), batch.end(), Compare{})) std::stable_sort(batch.begin(), batch.end(), Compare{});
+            if (unique) {
+                batch.erase(std::unique(batch.begin(), batch.end(), [](const T& a, const T& b) {return CompareKeys(a, b) == 0;}), batch.end());
+            }
+            if (batch.empty()) return;
+            Compact();
+            if ((long long)batch.size() * RebuildRatio >= size) {
+                std::vector<T> values;
+                values.reserve(size + batch.size());
+                if (unique) std::set_union(cbegin(), cend(), batch.begin(), batch.end(), std::back_inserter(values), Compare{});
+                else std::merge(cbegin(), cend(), batch.begin(), batch.end(), std::back_inserter(values), Compare{});
+                AssignSorted(values.begin(), (int)values.size());
+                return;
+            }
+            allocator.Reserve((int)batch.size());
+            root = Detach(MergeRange(root, batch.cbegin(), batch.cend(), unique));
+            size = SubtreeSize(root);
+        }
+
+        // Вливает отсортированный диапазон в поддерево p: диапазон делится ключом узла двоичным поиском,
+        // половины вливаются в детей. Поддеревья, куда не попало ни одного ключа, не посещаются,
+        // а склейка через узел нужна, только если высота изменённого ребёнка поменялась.
+        template <typename It>
+        Node<T>* MergeRange(Node<T>* p, It first, It last, bool unique) {
+            if (first == last) return p;
+            if (!p) return Detach(BuildSorted(first, (int)(last - first)));
+            It middle = std::lower_bound(first, last, p->key, Compare{});
+            It next = middle;
+            if (unique) {
+                while (next != last && CompareKeys(*next, p->key) == 0) ++next;
+            }
+            bool grown = false;
+            if (first != middle) {
+                Node<T>* child = p->left;
+                unsigned char height = Height(child);
+                int before = SubtreeSize(child);
+                child = MergeRange(child, first, middle, unique);
+                p->size += child->size - before;
+                grown = grown || child->height != height;
+                p->left = child;
+                child->parent = p;
+            }
+            if (next != last) {
+                Node<T>* child = p->right;
+                unsigned char height = Height(child);
+                int before = SubtreeSize(child);
+                child = MergeRange(child, next, last, unique);
+                p->size += child->size - before;
+                grown = grown || child->height != height;
+                p->right = child;
+                child->parent = p;
+            }
+            if (!grown) return p;
+            return Join(p->left, p, p->right);
+        }
+
+        // Спуск к месту вставки k; path получает адреса ссылок на пройденные узлы, slot и parent -
+        // место для нового узла. Если по пути встретился равный ключ, возвращается его узел:
+        // мёртвый узел нужно оживить, а живой в режиме Unique означает, что ключ уже есть.
+        // В остальных случаях равные ключи уходят вправо. Размеры поддеревьев не меняются.
+        template <bool Unique, typename K>
+        Node<T>* FindSlot(const K& k, PathBuffer<Node<T>**>& path, Node<T>**& slot, Node<T>*& parent) {
+            Node<T>** current = &root;
+            parent = nullptr;
+            while (*current) {
                 path.Push(current);
                 parent = *current;
-                current = &(*current)->left;
+                int order = CompareKeys(k, parent->key);
+                if (order == 0 && (Unique || parent->dead)) {
+                    if (Unique && parent->dead) {
+                        if (Node<T>* live = FindLive(parent, k)) return live;
+                    }
+                    return parent;
+                }
+                current = order < 0 ? &parent->left : &parent->right;
             }
-            *current = (*current)->right;
-            if (*current) {
-                (*current)->parent = parent;
+            slot = current;
+            return nullptr;
+        }
+
+        static void GrowPath(PathBuffer<Node<T>**>& path) {
+            for (int i = 0; i < path.GetSize(); i++) {
+                (*path[i])->size++;
             }
-            while (!path.IsEmpty()) {
-                Node<T>** q = path.Top();
-                path.Pop();
-                *q = Balance(*q);
+        }
+
+        // Ставит узел node на место узла old, лежащего в *slot, и освобождает old. Так мёртвый
+        // узел получает новый ключ, если ключ нельзя присвоить (например, у него есть const-поля).
+        Node<T>* ReplaceNode(Node<T>* old, Node<T>** slot, Node<T>* node) {
+            node->parent = old->parent;
+            node->left = old->left;
+            node->right = old->right;
+            node->height = old->height;
+            node->size = old->size;
+            node->dead = old->dead;
+            if (node->left) node->left->parent = node;
+            if (node->right) node->right->parent = node;
+            *slot = node;
+            allocator.Destroy(old);
+            return node;
+        }
+
+        // Мёртвый узел с тем же ключом оживает: ни выделения, ни поворотов.
+        void Revive(Node<T>* node, PathBuffer<Node<T>**>& path) {
+            node->dead = false;
+            GrowPath(path);
+            dead--;
+            size++;
+        }
+
+        template <bool Unique, typename K>
+        bool InsertKey(K&& k) {
+            PathBuffer<Node<T>**> path;
+            Node<T>** slot;
+            Node<T>* parent;
+            if (Node<T>* found = FindSlot<Unique>(k, path, slot, parent)) {
+                if (!found->dead) return false;
+                if constexpr (std::is_assignable_v<T&, K&&>) {
+                    found->key = std::forward<K>(k);
+                } else {
+                    found = ReplaceNode(found, path.Top(), allocator.Create(std::forward<K>(k), found->parent));
+                }
+                Revive(found, path);
+                return true;
+            }
+            *slot = allocator.Create(std::forward<K>(k), parent);
+            GrowPath(path);
+            size++;
+            Rebalance(path);
+            return true;
+        }
+
+        // Вставка уже построенного узла; возвращает узел с ключом и признак вставки.
+        template <bool Unique>
+        std::pair<Node<T>*, bool> LinkNode(Node<T>* node) {
+            PathBuffer<Node<T>**> path;
+            Node<T>** slot;
+            Node<T>* parent;
+            Node<T>* found;
+            try {
+                found = FindSlot<Unique>(node->key, path, slot, parent);
+                if constexpr (std::is_move_assignable_v<T>) {
+                    if (found && found->dead) found->key = std::move(node->key);
+                }
+            } catch (...) {
+                allocator.Destroy(node);
+                throw;
+            }
+            if (found) {
+                if (!found->dead) {
+                    allocator.Destroy(node);
+                    return {found, false};
+                }
+                if constexpr (std::is_move_assignable_v<T>) allocator.Destroy(node);
+                else found = ReplaceNode(found, path.Top(), node);
+                Revive(found, path);
+                return {found, true};
+            }
+            node->parent = parent;
+            *slot = node;
+            GrowPath(path);
+            size++;
+            Rebalance(path);
+            return {node, true};
+        }
+
+        template <typename K>
+        bool MarkDead(const K& k) {
+            Node<T>* node = FindNode(k);
+            if (!node) return false;
+            node->dead = true;
+            for (Node<T>* p = node; p; p = p->parent) {
+                p->size--;
+            }
+            size--;
+            dead++;
+            if (dead > maxDeadFraction * (size + dead)) Compact();
+            return true;
+        }
+
+        // Собирает сбалансированное дерево из уже существующих узлов.
+        Node<T>* Relink(Node<T>** nodes, int count, Node<T>* parent) {
+            if (count == 0) return nullptr;
+            int middle = count / 2;
+            Node<T>* p = nodes[middle];
+            p->parent = parent;
+            p->left = Relink(nodes, middle, p);
+            p->right = Relink(nodes + middle + 1, count - middle - 1, p);
+            FixHeight(p);
+            return p;
+        }
+
+        // Алгоритмы над множествами работают с живыми узлами: мёртвые узлы этого дерева
+        // вычищаются, а если они есть в other, операция выполняется над его уплотнённой копией.
+        template <typename F>
+        bool WithCompacted(const AVL_Tree& other, F&& operation) {
+            Compact();
+            if (!other.dead) return false;
+            AVL_Tree compacted(other);
+            compacted.Compact();
+            operation(compacted);
+            return true;
+        }
+
+        // Узел в *slot не имеет правого ребёнка; path - путь к нему без него самого.
+        void UnlinkRightmost(Node<T>** slot, PathBuffer<Node<T>**>& path) {
+            Node<T>* node = *slot;
+            *slot = node->left;
+            if (node->left) node->left->parent = node->parent;
+            allocator.Destroy(node);
+            Rebalance(path);
+        }
+
+        template <typename K>
+        bool RemoveKey(const K& k) {
+            PathBuffer<Node<T>**> path;
+            Node<T>** current = &root;
+            while (*current) {
+                int order = CompareKeys(k, (*current)->key);
+                if (order == 0) break;
+                path.Push(current);
+                current = order < 0 ? &(*current)->left : &(*current)->right;
+            }
+            if (!*current) return false;
+            for (int i = 0; i < path.GetSize(); i++) {
+                (*path[i])->size--;
+            }
+            Node<T>* toDelete = *current;
+
+            if (!toDelete->right) {
+                *current = toDelete->left;
+                if (toDelete->left) {
+                    toDelete->left->parent = toDelete->parent;
+                }
+            } else {
+                path.Push(current);
+                int index = path.GetSize();
+                Node<T>** slot = &toDelete->right;
+                while ((*slot)->left) {
+                    path.Push(slot);
+                    (*slot)->size--;
+                    slot = &(*slot)->left;
+                }
+                Node<T>* min = *slot;
+                *slot = min->right;
+                if (min->right) min->right->parent = min->parent;
+
+                min->left = toDelete->left;
+                min->right = toDelete->right;
+                min->parent = toDelete->parent;
+                min->height = toDelete->height;
+                min->size = toDelete->size - 1;
+                if (min->left) min->left->parent = min;
+                if (min->right) min->right->parent = min;
+                *current = min;
+                if (index < path.GetSize()) path[index] = &min->right;
+            }
+
+            allocator.Destroy(toDelete);
+            size--;
+            Rebalance(path);
+            return true;
+        }
+
+        static constexpr int ProbeGroup = 16;
+
+        // visit(i, узел с ключом keys[i] или nullptr) вызывается по возрастанию i.
+        template <typename F>
+        void ProbeMany(std::span<const T> keys, F&& visit) const {
+            Node<T>* current[ProbeGroup];
+            Node<T>* found[ProbeGroup];
+            for (std::size_t first = 0; first < keys.size(); first += ProbeGroup) {
+                int count = (int)std::min<std::size_t>(ProbeGroup, keys.size() - first);
+                const T* group = keys.data() + first;
+                for (int j = 0; j < count; j++) {
+                    current[j] = root;
+                    found[j] = nullptr;
+                }
+                for (bool active = root != nullptr; active;) {
+                    active = false;
+                    for (int j = 0; j < count; j++) {
+                        Node<T>* p = current[j];
+                        if (!p) continue;
+                        int order = CompareKeys(group[j], p->key);
+                        if (order == 0) {
+                            found[j] = p->dead ? FindLive(p, group[j]) : p;
+                            current[j] = nullptr;
+                            continue;
+                        }
+                        Node<T>* next = order < 0 ? p->left : p->right;
+                        if (next) __builtin_prefetch(next);
+                        current[j] = next;
+                        active = active || next;
+                    }
+                }
+                for (int j = 0; j < count; j++) {
+                    visit(first + j, found[j]);
+                }
+            }
+        }
+
+        // Число ключей, меньших k.
+        template <typename K>
+        int RankOf(const K& k) const {
+            int rank = 0;
+            Node<T>* current = root;
+            while (current) {
+                if (Less(current->key, k)) {
+                    rank += SubtreeSize(current->left) + !current->dead;
+                    current = current->right;
+                } else {
+                    current = current->left;
+                }
+            }
+            return rank;
+        }
+
+        template <typename K>
+        Node<T>* FindNode(const K& k) const {
+            Node<T>* current = root;
+            while (current) {
+                int order = CompareKeys(k, current->key);
+                if (order == 0) return current->dead ? FindLive(current, k) : current;
+                current = order < 0 ? current->left : current->right;
+            }
+            return nullptr;
+        }
+
+        // Живой узел с ключом k в поддереве p: после поворотов равные ключи
+        // могут оказаться по обе стороны от мёртвого.
+        template <typename K>
+        static Node<T>* FindLive(Node<T>* p, const K& k) {
+            if (!p) return nullptr;
+            int order = CompareKeys(k, p->key);
+            if (order == 0 && !p->dead) return p;
+            if (order <= 0) {
+                if (Node<T>* found = FindLive(p->left, k)) return found;
+            }
+            return order >= 0 ? FindLive(p->right, k) : nullptr;
+        }
+
+        template <typename A, typename B>
+        static bool Less(const A& a, const B& b) {
+            return Compare{}(a, b);
+        }
+
+        template <typename K>
+        Node<T>* LowerBoundNode(const K& k) const {
+            Node<T>* result = nullptr;
+            Node<T>* current = root;
+            while (current) {
+                if (Less(current->key, k)) {
+                    current = current->right;
+                } else {
+                    result = current;
+                    current = current->left;
+                }
+            }
+            return FirstLive(result);
+        }
+
+        template <typename K>
+        Node<T>* UpperBoundNode(const K& k) const {
+            Node<T>* result = nullptr;
+            Node<T>* current = root;
+            while (current) {
+                if (Less(k, current->key)) {
+                    result = current;
+                    current = current->left;
+                } else {
+                    current = current->right;
+                }
+            }
+            return FirstLive(result);
+        }
+
+        Node<T>* FloorNode(const T& k) const {
+            Node<T>* result = nullptr;
+            Node<T>* current = root;
+            while (current) {
+                if (Less(k, current->key)) {
+                    current = current->left;
+                } else {
+                    result = current;
+                    current = current->right;
+                }
+            }
+            return LastLive(result);
+        }
+
+        // Следующий и предыдущий живые узлы.
+        static Node<T>* Next(Node<T>* p) {
+            do {
+                if (p->right) {
+                    p = p->right;
+                    while (p->left) {
+                        p = p->left;
+                    }
+                    continue;
+                }
+                while (p->parent && p == p->parent->right) {
+                    p = p->parent;
+                }
+                p = p->parent;
+            } while (p && p->dead);
+            return p;
+        }
+
+        static Node<T>* Prev(Node<T>* p) {
+            do {
+                if (p->left) {
+                    p = p->left;
+                    while (p->right) {
+                        p = p->right;
+                    }
+                    continue;
+                }
+                while (p->parent && p == p->parent->left) {
+                    p = p->parent;
+                }
+                p = p->parent;
+            } while (p && p->dead);
+            return p;
+        }
+
+        static Node<T>* FirstLive(Node<T>* p) {
+            return p && p->dead ? Next(p) : p;
+        }
+
+        static Node<T>* LastLive(Node<T>* p) {
+            return p && p->dead ? Prev(p) : p;
+        }
+
+        Node<T>* SelectNode(int index) const {
+            if (index < 0 || index >= size) return nullptr;
+            Node<T>* current = root;
+            while (current) {
+                int leftSize = SubtreeSize(current->left);
+                if (index < leftSize) {
+                    current = current->left;
+                } else if (index == leftSize && !current->dead) {
+                    return current;
+                } else {
+                    index -= leftSize + !current->dead;
+                    current = current->right;
+                }
             }
-            return Balance(p);
+            return nullptr;
         }
 
         Node<T>* FindMin(Node<T>* p) const {
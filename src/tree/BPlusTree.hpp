@@ -0,0 +1,1128 @@
+#ifndef BPLUSTREE_HPP
+#define BPLUSTREE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include "../../auxiliary/Iterator.hpp"
+#include "Tree.hpp"
+#include "TreeHelpers.hpp"
+#include "FrozenSet.hpp"
+
+// Узлы B+-дерева. Ключи хранятся только в листьях, листья связаны в двусвязный список;
+// ключ keys[i] внутреннего узла не больше ключей children[i + 1] и не меньше ключей children[i].
+template <typename T>
+struct BPlusNode {
+    int count;
+    bool leaf;
+};
+
+template <typename T, int Capacity>
+struct alignas(64) BPlusLeaf : BPlusNode<T> {
+    BPlusLeaf* prev;
+    BPlusLeaf* next;
+    T keys[Capacity];
+};
+
+template <typename T, int Capacity>
+struct alignas(64) BPlusInner : BPlusNode<T> {
+    T keys[Capacity];
+    BPlusNode<T>* children[Capacity + 1];
+};
+
+template <typename T, bool IsConst, typename Leaf>
+class BPlusTreeIterator : public IIterator<T, IsConst> {
+    public:
+        using value_type = typename IIterator<T, IsConst>::value_type;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = typename IIterator<T, IsConst>::reference;
+        using difference_type = typename IIterator<T, IsConst>::difference_type;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        BPlusTreeIterator(Leaf* l, int i, Leaf* const* t) : leaf(l), index(i), tail(t) {}
+
+        bool HasNext() const override {
+            return leaf && (index + 1 < leaf->count || leaf->next);
+        }
+
+        bool HasPrev() const {
+            return leaf && (index > 0 || leaf->prev);
+        }
+
+        reference Current() override {
+            return operator*();
+        }
+
+        void MoveNext() override {
+            operator++();
+        }
+
+        void MovePrev() {
+            operator--();
+        }
+
+        BPlusTreeIterator& operator++() {
+            toNext();
+            return *this;
+        }
+
+        BPlusTreeIterator operator++(int) {
+            BPlusTreeIterator tmp = *this;
+            toNext();
+            return tmp;
+        }
+
+        BPlusTreeIterator& operator--() {
+            toPrev();
+            return *this;
+        }
+
+        BPlusTreeIterator operator--(int) {
+            BPlusTreeIterator tmp = *this;
+            toPrev();
+            return tmp;
+        }
+
+        reference operator*() const {
+            if (!leaf) throw std::out_of_range("Iterator out of range");
+            return leaf->keys[index];
+        }
+
+        pointer operator->() const {
+            return &(operator*());
+        }
+
+        bool operator==(const BPlusTreeIterator& other) const {
+            return leaf == other.leaf && index == other.index;
+        }
+
+        bool operator!=(const BPlusTreeIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Leaf* leaf;
+        int index;
+        Leaf* const* tail;
+
+        void toNext() {
+            if (!leaf) {
+                throw std::out_of_range("Iterator out of range");
+            }
+            if (++index == leaf->count) {
+                leaf = leaf->next;
+                index = 0;
+            }
+        }
+
+        void toPrev() {
+            if (!leaf) {
+                if (!tail || !*tail) {
+                    throw std::out_of_range("Iterator out of range");
+                }
+                leaf = *tail;
+                index = leaf->count - 1;
+            } else if (index > 0) {
+                index--;
+            } else {
+                leaf = leaf->prev;
+                index = leaf ? leaf->count - 1 : 0;
+            }
+        }
+};
+
+// Мультимножество на B+-дереве: узел занимает около NodeBytes байт, выровнен по кэш-линии,
+// и за спуск на уровень читается один узел вместо одного ключа, как в AVL_Tree.
+// Для арифметических ключей с std::less<> хвост узла заполняется максимальным значением,
+// и позиция в узле считается сравнением со всеми слотами сразу: цикл фиксированной
+// длины компилятор векторизует. Для остальных ключей в узле идёт двоичный поиск.
+template <typename T, int NodeBytes = 256, typename Compare = std::less<>>
+class BPlusTree : public Tree<T>, public IEnumerable<T> {
+    public:
+        static constexpr int LeafCapacity = (int)std::max<long>(4, ((long)NodeBytes - (long)(sizeof(BPlusNode<T>) + 2 * sizeof(void*))) / (long)sizeof(T));
+        static constexpr int InnerCapacity = (int)std::max<long>(4, ((long)NodeBytes - (long)(sizeof(BPlusNode<T>) + sizeof(void*))) / (long)(sizeof(T) + sizeof(void*)));
+
+    private:
+        using Node = BPlusNode<T>;
+        using Leaf = BPlusLeaf<T, LeafCapacity>;
+        using Inner = BPlusInner<T, InnerCapacity>;
+
+    public:
+        using value_type = T;
+        using iterator = BPlusTreeIterator<T, false, Leaf>;
+        using const_iterator = BPlusTreeIterator<T, true, Leaf>;
+
+        static constexpr bool IsTransparent = IsTransparentCompare<Compare>;
+
+        template <typename U>
+        using Rebind = BPlusTree<U, NodeBytes, Compare>;
+
+        template <typename A, typename B>
+        static int CompareKeys(const A& a, const B& b) {
+            return ThreeWayCompare<Compare>(a, b);
+        }
+
+        iterator begin() {
+            return iterator(head, 0, &tail);
+        }
+        iterator end() {
+            return iterator(nullptr, 0, &tail);
+        }
+        const_iterator begin() const {
+            return const_iterator(head, 0, &tail);
+        }
+        const_iterator end() const {
+            return const_iterator(nullptr, 0, &tail);
+        }
+        const_iterator cbegin() const {
+            return const_iterator(head, 0, &tail);
+        }
+        const_iterator cend() const {
+            return const_iterator(nullptr, 0, &tail);
+        }
+
+        std::unique_ptr<IIterator<T, false>> GetIterator() override {
+            return std::make_unique<iterator>(begin());
+        }
+        std::unique_ptr<IIterator<T, true>> GetConstIterator() const override {
+            return std::make_unique<const_iterator>(cbegin());
+        }
+
+        BPlusTree() : root(nullptr), head(nullptr), tail(nullptr), size(0) {}
+
+        BPlusTree(const BPlusTree& other) : root(nullptr), head(nullptr), tail(nullptr), size(0) {
+            AssignSorted(other.cbegin(), other.size);
+        }
+
+        BPlusTree(BPlusTree&& other) noexcept : root(other.root), head(other.head), tail(other.tail), size(other.size) {
+            other.root = nullptr;
+            other.head = other.tail = nullptr;
+            other.size = 0;
+        }
+
+        BPlusTree& operator=(const BPlusTree& other) {
+            if (this == &other) return *this;
+            Clear();
+            AssignSorted(other.cbegin(), other.size);
+            return *this;
+        }
+
+        BPlusTree& operator=(BPlusTree&& other) noexcept {
+            if (this == &other) return *this;
+            Clear();
+            root = other.root;
+            head = other.head;
+            tail = other.tail;
+            size = other.size;
+            other.root = nullptr;
+            other.head = other.tail = nullptr;
+            other.size = 0;
+            return *this;
+        }
+
+        // Строит дерево из отсортированного диапазона за O(n); узлы заполняются почти целиком.
+        template <typename Range>
+        static BPlusTree* FromSorted(const Range& range) {
+            BPlusTree* result = new BPlusTree();
+            auto first = std::begin(range);
+            result->AssignSorted(first, (int)std::distance(first, std::end(range)));
+            return result;
+        }
+
+        int Size() const override {
+            return size;
+        }
+
+        bool IsEmpty() const {
+            return size == 0;
+        }
+
+        T GetMin() const {
+            if (!head) throw std::out_of_range("Tree is empty");
+            return head->keys[0];
+        }
+
+        T GetMax() const {
+            if (!tail) throw std::out_of_range("Tree is empty");
+            return tail->keys[tail->count - 1];
+        }
+
+        void Insert(const T& k) override {
+            InsertKey(k);
+        }
+
+        void Insert(T&& k) {
+            InsertKey(std::move(k));
+        }
+
+        // Вставка пачки: большая относительно дерева пачка сливается с листьями и дерево
+        // строится заново за O(n + m), маленькая вставляется по ключу.
+        template <typename Range>
+        void InsertMany(const Range& range) {
+            std::vector<T> batch(std::begin(range), std::end(range));
+            MergeBatch(batch, false);
+        }
+
+        // То же для множеств: ключи, повторяющиеся в пачке или уже лежащие в дереве, пропускаются.
+        template <typename Range>
+        void InsertManyUnique(const Range& range) {
+            std::vector<T> batch(std::begin(range), std::end(range));
+            MergeBatch(batch, true);
+        }
+
+        bool Remove(const T& k) override {
+            return RemoveKey(k);
+        }
+        template <typename K> requires IsTransparent
+        bool Remove(const K& k) {
+            return RemoveKey(k);
+        }
+
+        // Удаляет наибольший ключ и возвращает его; из равных наибольших - последний вставленный.
+        T PopMax() {
+            if (!root) throw std::out_of_range("Tree is empty");
+            T result = RemoveLast(root);
+            size--;
+            ShrinkRoot();
+            return result;
+        }
+
+        bool Contains(const T& k) const override {
+            return FindPosition(k).first != nullptr;
+        }
+        template <typename K> requires IsTransparent
+        bool Contains(const K& k) const {
+            return FindPosition(k).first != nullptr;
+        }
+
+        // Спуск по B+-дереву короткий, поэтому ключи пачки ищутся по одному.
+        void ContainsMany(std::span<const T> keys, std::span<bool> out) const {
+            if (out.size() < keys.size()) throw std::invalid_argument("Result span is too short");
+            for (std::size_t i = 0; i < keys.size(); i++) {
+                out[i] = Contains(keys[i]);
+            }
+        }
+
+        std::vector<iterator> FindMany(std::span<const T> keys) {
+            std::vector<iterator> result;
+            result.reserve(keys.size());
+            for (const T& k : keys) result.push_back(Find(k));
+            return result;
+        }
+        std::vector<const_iterator> FindMany(std::span<const T> keys) const {
+            std::vector<const_iterator> result;
+            result.reserve(keys.size());
+            for (const T& k : keys) result.push_back(Find(k));
+            return result;
+        }
+
+        iterator Find(const T& k) {
+            auto [leaf, index] = FindPosition(k);
+            return iterator(leaf, index, &tail);
+        }
+        const_iterator Find(const T& k) const {
+            auto [leaf, index] = FindPosition(k);
+            return const_iterator(leaf, index, &tail);
+        }
+        template <typename K> requires IsTransparent
+        iterator Find(const K& k) {
+            auto [leaf, index] = FindPosition(k);
+            return iterator(leaf, index, &tail);
+        }
+        template <typename K> requires IsTransparent
+        const_iterator Find(const K& k) const {
+            auto [leaf, index] = FindPosition(k);
+            return const_iterator(leaf, index, &tail);
+        }
+
+        // Поиск по порядку
+        iterator LowerBound(const T& k) {
+            auto [leaf, index] = BoundPosition<false>(k);
+            return iterator(leaf, index, &tail);
+        }
+        const_iterator LowerBound(const T& k) const {
+            auto [leaf, index] = BoundPosition<false>(k);
+            return const_iterator(leaf, index, &tail);
+        }
+
+        iterator UpperBound(const T& k) {
+            auto [leaf, index] = BoundPosition<true>(k);
+            return iterator(leaf, index, &tail);
+        }
+        const_iterator UpperBound(const T& k) const {
+            auto [leaf, index] = BoundPosition<true>(k);
+            return const_iterator(leaf, index, &tail);
+        }
+
+        template <typename K> requires IsTransparent
+        iterator LowerBound(const K& k) {
+            auto [leaf, index] = BoundPosition<false>(k);
+            return iterator(leaf, index, &tail);
+        }
+        template <typename K> requires IsTransparent
+        const_iterator LowerBound(const K& k) const {
+            auto [leaf, index] = BoundPosition<false>(k);
+            return const_iterator(leaf, index, &tail);
+        }
+
+        template <typename K> requires IsTransparent
+        iterator UpperBound(const K& k) {
+            auto [leaf, index] = BoundPosition<true>(k);
+            return iterator(leaf, index, &tail);
+        }
+        template <typename K> requires IsTransparent
+        const_iterator UpperBound(const K& k) const {
+            auto [leaf, index] = BoundPosition<true>(k);
+            return const_iterator(leaf, index, &tail);
+        }
+
+        iterator Floor(const T& k) {
+            iterator it = UpperBound(k);
+            if (it == begin()) return end();
+            return --it;
+        }
+        const_iterator Floor(const T& k) const {
+            const_iterator it = UpperBound(k);
+            if (it == cbegin()) return cend();
+            return --it;
+        }
+
+        iterator Ceiling(const T& k) {
+            return LowerBound(k);
+        }
+        const_iterator Ceiling(const T& k) const {
+            return LowerBound(k);
+        }
+
+        // Обходит ключи из [lo, hi) по возрастанию за O(log n + k).
+        template <typename F>
+        void ForEachInRange(const T& lo, const T& hi, F&& visit) const {
+            auto [leaf, index] = BoundPosition<false>(lo);
+            for (; leaf; leaf = leaf->next, index = 0) {
+                for (; index < leaf->count; index++) {
+                    if (!Less(leaf->keys[index], hi)) return;
+                    if (!VisitKey(visit, leaf->keys[index])) return;
+                }
+            }
+        }
+
+        // Порядковые статистики. Размеры поддеревьев не хранятся, поэтому листья
+        // до нужной позиции проходятся целиком: O(n / B) вместо O(log n) у AVL_Tree.
+        int Rank(const T& k) const {
+            return RankOf(k);
+        }
+
+        template <typename K> requires IsTransparent
+        int Rank(const K& k) const {
+            return RankOf(k);
+        }
+
+        T Select(int index) const {
+            if (index < 0 || index >= size) throw std::out_of_range("Index out of range");
+            Leaf* leaf = head;
+            while (index >= leaf->count) {
+                index -= leaf->count;
+                leaf = leaf->next;
+            }
+            return leaf->keys[index];
+        }
+
+        int CountRange(const T& lo, const T& hi) const {
+            int count = Rank(hi) - Rank(lo);
+            return count > 0 ? count : 0;
+        }
+
+        // Операции над множествами слиянием листьев за O(n + m) с перестройкой дерева.
+        // Ключи в обоих деревьях должны быть уникальны.
+        void UnionWith(const BPlusTree& other) {
+            if (this == &other || !other.size) return;
+            std::vector<T> values;
+            values.reserve(size + other.size);
+            std::set_union(cbegin(), cend(), other.cbegin(), other.cend(), std::back_inserter(values), Compare{});
+            Rebuild(values);
+        }
+
+        void IntersectWith(const BPlusTree& other) {
+            if (this == &other) return;
+            std::vector<T> values;
+            std::set_intersection(cbegin(), cend(), other.cbegin(), other.cend(), std::back_inserter(values), Compare{});
+            Rebuild(values);
+        }
+
+        void DifferenceWith(const BPlusTree& other) {
+            if (this == &other) {
+                Clear();
+                return;
+            }
+            std::vector<T> values;
+            std::set_difference(cbegin(), cend(), other.cbegin(), other.cend(), std::back_inserter(values), Compare{});
+            Rebuild(values);
+        }
+
+        // Обходы. Внутренние узлы хранят только копии разделителей, поэтому прямой
+        // и обратный обходы совпадают с симметричным, а их зеркальные варианты - с ReverseInOrder.
+        template <typename F>
+        bool InOrder(F&& visit) const {
+            for (Leaf* leaf = head; leaf; leaf = leaf->next) {
+                for (int i = 0; i < leaf->count; i++) {
+                    if (!VisitKey(visit, leaf->keys[i])) return false;
+                }
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool ReverseInOrder(F&& visit) const {
+            for (Leaf* leaf = tail; leaf; leaf = leaf->prev) {
+                for (int i = leaf->count - 1; i >= 0; i--) {
+                    if (!VisitKey(visit, leaf->keys[i])) return false;
+                }
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool PreOrder(F&& visit) const {
+            return InOrder<F&>(visit);
+        }
+
+        template <typename F>
+        bool ReversePreOrder(F&& visit) const {
+            return ReverseInOrder<F&>(visit);
+        }
+
+        template <typename F>
+        bool PostOrder(F&& visit) const {
+            return InOrder<F&>(visit);
+        }
+
+        template <typename F>
+        bool ReversePostOrder(F&& visit) const {
+            return ReverseInOrder<F&>(visit);
+        }
+
+        void PreOrder(std::function<void(const T&)> visit) const override {
+            PreOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReversePreOrder(std::function<void(const T&)> visit) const override {
+            ReversePreOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void InOrder(std::function<void(const T&)> visit) const override {
+            InOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReverseInOrder(std::function<void(const T&)> visit) const override {
+            ReverseInOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void PostOrder(std::function<void(const T&)> visit) const override {
+            PostOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReversePostOrder(std::function<void(const T&)> visit) const override {
+            ReversePostOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        bool Traverse(BypassType order, std::function<VisitResult(const T&)> visit) const override {
+            return Traverse<std::function<VisitResult(const T&)>&>(order, visit);
+        }
+
+        template <typename F>
+        bool Traverse(BypassType order, F&& visit) const {
+            switch (order) {
+                case BypassType::PreOrder : return PreOrder(visit);
+                case BypassType::ReversePreOrder : return ReversePreOrder(visit);
+                case BypassType::InOrder : return InOrder(visit);
+                case BypassType::ReverseInOrder : return ReverseInOrder(visit);
+                case BypassType::PostOrder : return PostOrder(visit);
+                case BypassType::ReversePostOrder : return ReversePostOrder(visit);
+                default:
+                    throw std::invalid_argument("Unknown Bypass type");
+            }
+        }
+
+        // Поддерево самого верхнего узла, где k встречается разделителем, или лист с k.
+        BPlusTree* GetSubTree(const T& k) const override {
+            BPlusTree* result = new BPlusTree();
+            if (!Contains(k)) return result;
+            Node* current = root;
+            while (!current->leaf) {
+                Inner* inner = AsInner(current);
+                int i = Position<false>(inner->keys, inner->count, k);
+                if (i < inner->count && CompareKeys(inner->keys[i], k) == 0) break;
+                current = inner->children[i];
+            }
+            std::vector<T> values;
+            CollectSubtree(current, values);
+            result->AssignSorted(values.cbegin(), (int)values.size());
+            return result;
+        }
+
+        BPlusTree* Concat(Tree<T>* other) const override {
+            BPlusTree* tree = dynamic_cast<BPlusTree*>(other);
+            if (!tree) {
+                BPlusTree* result = new BPlusTree(*this);
+                other->PreOrder([result](const T& value) {result->Insert(value);});
+                return result;
+            }
+            std::vector<T> values;
+            values.reserve(size + tree->size);
+            std::merge(cbegin(), cend(), tree->cbegin(), tree->cend(), std::back_inserter(values), Compare{});
+            return FromSorted(values);
+        }
+
+        BPlusTree* Clutch(Tree<T>* other) override {
+            BPlusTree* tree = dynamic_cast<BPlusTree*>(other);
+            if (!tree) {
+                other->PreOrder([this](const T& value) {this->Insert(value);});
+                return this;
+            }
+            if (!tree->size) return this;
+            std::vector<T> values;
+            values.reserve(size + tree->size);
+            std::merge(cbegin(), cend(), tree->cbegin(), tree->cend(), std::back_inserter(values), Compare{});
+            Rebuild(values);
+            return this;
+        }
+
+        template <typename U>
+        BPlusTree<U, NodeBytes, Compare>* Map(std::function<U(T)> f) const {
+            std::vector<U> values;
+            values.reserve(size);
+            InOrder([&values, &f](const T& value) {values.push_back(f(value));});
+            std::stable_sort(values.begin(), values.end(), Compare{});
+            return BPlusTree<U, NodeBytes, Compare>::FromSorted(values);
+        }
+
+        BPlusTree* Where(std::function<bool(T)> f) const {
+            std::vector<T> values;
+            InOrder([&values, &f](const T& value) {
+                if (f(value)) values.push_back(value);
+            });
+            return FromSorted(values);
+        }
+
+        // Первые limit подходящих элементов; обход останавливается на последнем из них.
+        BPlusTree* Where(std::function<bool(T)> f, int limit) const {
+            std::vector<T> values;
+            if (limit > 0) {
+                InOrder([&values, &f, limit](const T& value) {
+                    if (f(value)) values.push_back(value);
+                    return (int)values.size() < limit ? VisitResult::Continue : VisitResult::Stop;
+                });
+            }
+            return FromSorted(values);
+        }
+
+        // Наибольший префикс (в порядке возрастания), все элементы которого удовлетворяют f.
+        BPlusTree* TakeWhile(std::function<bool(T)> f) const {
+            std::vector<T> values;
+            InOrder([&values, &f](const T& value) {
+                if (!f(value)) return VisitResult::Stop;
+                values.push_back(value);
+                return VisitResult::Continue;
+            });
+            return FromSorted(values);
+        }
+
+        // Наименьший элемент, удовлетворяющий pred, или end().
+        template <typename F>
+        iterator FindFirst(F&& pred) {
+            iterator it = begin();
+            while (it != end() && !pred(*it)) ++it;
+            return it;
+        }
+        template <typename F>
+        const_iterator FindFirst(F&& pred) const {
+            const_iterator it = cbegin();
+            while (it != cend() && !pred(*it)) ++it;
+            return it;
+        }
+
+        // Неизменяемый снимок для чтения; повторяющиеся ключи схлопываются в один.
+        FrozenSet<T, Compare>* Freeze() const {
+            return FrozenSet<T, Compare>::FromSorted(*this);
+        }
+
+        static BPlusTree* fromString(const std::string& data) {
+            std::vector<T> values;
+            std::istringstream iss(data);
+            char c;
+            T value;
+            if (iss >> value) {
+                values.push_back(value);
+                while (iss >> c >> value) {
+                    if (c != ',') break;
+                    values.push_back(value);
+                }
+            }
+            if (!std::is_sorted(values.begin(), values.end(), Compare{})) std::stable_sort(values.begin(), values.end(), Compare{});
+            return FromSorted(values);
+        }
+
+        std::string toString(BypassType order = BypassType::InOrder) const {
+            std::ostringstream oss;
+            Traverse(order, [&oss](const T& value) {oss << value << " ";});
+            return oss.str();
+        }
+
+        void Clear() override {
+            if (root) DestroySubtree(root);
+            root = nullptr;
+            head = tail = nullptr;
+            size = 0;
+        }
+
+        ~BPlusTree() override {
+            Clear();
+        }
+
+    private:
+        Node* root;
+        Leaf* head;
+        Leaf* tail;
+        int size;
+
+        static constexpr int MinLeafKeys = LeafCapacity / 2;
+        static constexpr int MinInnerKeys = (InnerCapacity - 1) / 2;
+        static constexpr bool LinearSearch = std::is_arithmetic_v<T> && std::is_same_v<Compare, std::less<>>;
+
+        template <typename A, typename B>
+        static bool Less(const A& a, const B& b) {
+            return Compare{}(a, b);
+        }
+
+        static Leaf* AsLeaf(Node* node) {
+            return static_cast<Leaf*>(node);
+        }
+
+        static Inner* AsInner(Node* node) {
+            return static_cast<Inner*>(node);
+        }
+
+        static bool IsFull(Node* node) {
+            return node->count == (node->leaf ? LeafCapacity : InnerCapacity);
+        }
+
+        // Слоты за count держат значение, не меньшее любого ключа.
+        static T Sentinel() {
+            if constexpr (std::numeric_limits<T>::has_infinity) return std::numeric_limits<T>::infinity();
+            else return std::numeric_limits<T>::max();
+        }
+
+        template <int Capacity>
+        static void Seal(T (&keys)[Capacity], int count) {
+            if constexpr (LinearSearch) std::fill(keys + count, keys + Capacity, Sentinel());
+        }
+
+        // Число ключей узла, меньших k (Upper == false) или не больших k (Upper == true).
+        template <bool Upper, int Capacity, typename K>
+        static int Position(const T (&keys)[Capacity], int count, const K& k) {
+            if constexpr (LinearSearch && std::is_same_v<K, T>) {
+                int position = 0;
+                for (int i = 0; i < Capacity; i++) {
+                    position += Upper ? !(k < keys[i]) : keys[i] < k;
+                }
+                return position < count ? position : count;
+            } else {
+                int lo = 0;
+                int hi = count;
+                while (lo < hi) {
+                    int mid = (lo + hi) / 2;
+                    if (Upper ? !Less(k, keys[mid]) : Less(keys[mid], k)) lo = mid + 1;
+                    else hi = mid;
+                }
+                return lo;
+            }
+        }
+
+        static Leaf* NewLeaf() {
+            Leaf* leaf = new Leaf();
+            leaf->leaf = true;
+            Seal(leaf->keys, 0);
+            return leaf;
+        }
+
+        static Inner* NewInner() {
+            Inner* inner = new Inner();
+            inner->leaf = false;
+            Seal(inner->keys, 0);
+            return inner;
+        }
+
+        static void DeleteNode(Node* node) {
+            if (node->leaf) delete AsLeaf(node);
+            else delete AsInner(node);
+        }
+
+        static void DestroySubtree(Node* node) {
+            if (!node->leaf) {
+                Inner* inner = AsInner(node);
+                for (int i = 0; i <= inner->count; i++) DestroySubtree(inner->children[i]);
+            }
+            DeleteNode(node);
+        }
+
+        static void CollectSubtree(Node* node, std::vector<T>& values) {
+            if (node->leaf) {
+                Leaf* leaf = AsLeaf(node);
+                values.insert(values.end(), leaf->keys, leaf->keys + leaf->count);
+                return;
+            }
+            Inner* inner = AsInner(node);
+            for (int i = 0; i <= inner->count; i++) CollectSubtree(inner->children[i], values);
+        }
+
+        void Rebuild(const std::vector<T>& values) {
+            Clear();
+            AssignSorted(values.cbegin(), (int)values.size());
+        }
+
+        static constexpr int RebuildRatio = 4;
+
+        void MergeBatch(std::vector<T>& batch, bool unique) {
+            if (!std::is_sorted(batch.begin(), batch.end(), Compare{})) std::stable_sort(batch.begin(), batch.end(), Compare{});
+            if (unique) {
+                batch.erase(std::unique(batch.begin(), batch.end(), [](const T& a, const T& b) {return CompareKeys(a, b) == 0;}), batch.end());
+            }
+            if (batch.empty()) return;
+            if ((long long)batch.size() * RebuildRatio >= size) {
+                std::vector<T> values;
+                values.reserve(size + batch.size());
+                if (unique) std::set_union(cbegin(), cend(), batch.begin(), batch.end(), std::back_inserter(values), Compare{});
+                else std::merge(cbegin(), cend(), batch.begin(), batch.end(), std::back_inserter(values), Compare{});
+                Rebuild(values);
+                return;
+            }
+            for (const T& value : batch) {
+                if (!unique || !Contains(value)) Insert(value);
+            }
+        }
+
+        // Листья и узлы каждого уровня получают поровну элементов, так что ни один
+        // не оказывается заполнен меньше чем наполовину.
+        template <typename It>
+        void AssignSorted(It first, int count) {
+            if (count <= 0) return;
+            int leaves = (count + LeafCapacity - 1) / LeafCapacity;
+            std::vector<Node*> level;
+            std::vector<T> lows;
+            level.reserve(leaves);
+            lows.reserve(leaves);
+            for (int i = 0; i < leaves; i++) {
+                Leaf* leaf = NewLeaf();
+                leaf->count = count / leaves + (i < count % leaves);
+                for (int j = 0; j < leaf->count; j++, ++first) {
+                    leaf->keys[j] = *first;
+                }
+                leaf->prev = tail;
+                if (tail) tail->next = leaf;
+                else head = leaf;
+                tail = leaf;
+                level.push_back(leaf);
+                lows.push_back(leaf->keys[0]);
+            }
+            while (level.size() > 1) {
+                int total = (int)level.size();
+                int nodes = (total + InnerCapacity) / (InnerCapacity + 1);
+                std::vector<Node*> parents;
+                std::vector<T> parentLows;
+                parents.reserve(nodes);
+                parentLows.reserve(nodes);
+                for (int i = 0, at = 0; i < nodes; i++) {
+                    int take = total / nodes + (i < total % nodes);
+                    Inner* inner = NewInner();
+                    for (int j = 0; j < take; j++) {
+                        inner->children[j] = level[at + j];
+                        if (j > 0) inner->keys[j - 1] = lows[at + j];
+                    }
+                    inner->count = take - 1;
+                    parents.push_back(inner);
+                    parentLows.push_back(lows[at]);
+                    at += take;
+                }
+                level.swap(parents);
+                lows.swap(parentLows);
+            }
+            root = level[0];
+            size = count;
+        }
+
+        // Полные узлы делятся по пути вниз, поэтому вставка обходится без возврата к корню.
+        template <typename K>
+        void InsertKey(K&& k) {
+            if (!root) {
+                head = tail = NewLeaf();
+                root = head;
+            }
+            if (IsFull(root)) {
+                Inner* top = NewInner();
+                top->children[0] = root;
+                SplitChild(top, 0);
+                root = top;
+            }
+            Node* current = root;
+            while (!current->leaf) {
+                Inner* inner = AsInner(current);
+                int i = Position<true>(inner->keys, inner->count, k);
+                if (IsFull(inner->children[i])) {
+                    SplitChild(inner, i);
+                    if (!Less(k, inner->keys[i])) i++;
+                }
+                current = inner->children[i];
+            }
+            Leaf* leaf = AsLeaf(current);
+            int i = Position<true>(leaf->keys, leaf->count, k);
+            std::move_backward(leaf->keys + i, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+            leaf->keys[i] = std::forward<K>(k);
+            leaf->count++;
+            size++;
+        }
+
+        // Делит полный узел children[i] пополам; parent заполнен не полностью.
+        void SplitChild(Inner* parent, int i) {
+            Node* child = parent->children[i];
+            Node* right;
+            T separator;
+            if (child->leaf) {
+                Leaf* left = AsLeaf(child);
+                Leaf* sibling = NewLeaf();
+                int half = LeafCapacity / 2;
+                std::move(left->keys + half, left->keys + left->count, sibling->keys);
+                sibling->count = left->count - half;
+                left->count = half;
+                Seal(left->keys, left->count);
+                sibling->next = left->next;
+                sibling->prev = left;
+                if (left->next) left->next->prev = sibling;
+                else tail = sibling;
+                left->next = sibling;
+                separator = sibling->keys[0];
+                right = sibling;
+            } else {
+                Inner* left = AsInner(child);
+                Inner* sibling = NewInner();
+                int half = InnerCapacity / 2;
+                separator = std::move(left->keys[half]);
+                std::move(left->keys + half + 1, left->keys + left->count, sibling->keys);
+                std::copy(left->children + half + 1, left->children + left->count + 1, sibling->children);
+                sibling->count = left->count - half - 1;
+                left->count = half;
+                Seal(left->keys, left->count);
+                right = sibling;
+            }
+            std::move_backward(parent->keys + i, parent->keys + parent->count, parent->keys + parent->count + 1);
+            std::copy_backward(parent->children + i + 1, parent->children + parent->count + 1, parent->children + parent->count + 2);
+            parent->keys[i] = std::move(separator);
+            parent->children[i + 1] = right;
+            parent->count++;
+        }
+
+        template <typename K>
+        bool RemoveKey(const K& k) {
+            if (!root || !RemoveFrom(root, k)) return false;
+            size--;
+            ShrinkRoot();
+            return true;
+        }
+
+        // Опустевший после удаления корень уступает место единственному ребёнку.
+        void ShrinkRoot() {
+            if (root->count > 0) return;
+            if (root->leaf) {
+                DeleteNode(root);
+                root = nullptr;
+                head = tail = nullptr;
+            } else {
+                Node* old = root;
+                root = AsInner(root)->children[0];
+                DeleteNode(old);
+            }
+        }
+
+        // Последний ключ лежит в самом правом листе; узлы на пути восполняются, как в RemoveFrom.
+        T RemoveLast(Node* node) {
+            if (node->leaf) {
+                Leaf* leaf = AsLeaf(node);
+                leaf->count--;
+                T result = std::move(leaf->keys[leaf->count]);
+                Seal(leaf->keys, leaf->count);
+                return result;
+            }
+            Inner* inner = AsInner(node);
+            T result = RemoveLast(inner->children[inner->count]);
+            Rebalance(inner, inner->count);
+            return result;
+        }
+
+        template <typename K>
+        int RankOf(const K& k) const {
+            auto [target, index] = BoundPosition<false>(k);
+            if (!target) return size;
+            int rank = index;
+            for (Leaf* leaf = head; leaf != target; leaf = leaf->next) rank += leaf->count;
+            return rank;
+        }
+
+        // Разделитель, равный k, не гарантирует, что k лежит правее него:
+        // равные ключи могут оказаться в соседних поддеревьях, поэтому они проверяются по очереди.
+        template <typename K>
+        bool RemoveFrom(Node* node, const K& k) {
+            if (node->leaf) {
+                Leaf* leaf = AsLeaf(node);
+                int i = Position<false>(leaf->keys, leaf->count, k);
+                if (i == leaf->count || CompareKeys(leaf->keys[i], k) != 0) return false;
+                std::move(leaf->keys + i + 1, leaf->keys + leaf->count, leaf->keys + i);
+                leaf->count--;
+                Seal(leaf->keys, leaf->count);
+                return true;
+            }
+            Inner* inner = AsInner(node);
+            for (int i = Position<false>(inner->keys, inner->count, k); i <= inner->count; i++) {
+                if (RemoveFrom(inner->children[i], k)) {
+                    Rebalance(inner, i);
+                    return true;
+                }
+                if (i == inner->count || CompareKeys(inner->keys[i], k) != 0) return false;
+            }
+            return false;
+        }
+
+        // Восполняет children[i] после удаления: занимает ключ у соседа или сливается с ним.
+        void Rebalance(Inner* parent, int i) {
+            Node* child = parent->children[i];
+            Node* left = i > 0 ? parent->children[i - 1] : nullptr;
+            Node* right = i < parent->count ? parent->children[i + 1] : nullptr;
+            if (child->leaf) {
+                if (child->count >= MinLeafKeys) return;
+                if (left && left->count > MinLeafKeys) {
+                    BorrowFromLeftLeaf(parent, i);
+                } else if (right && right->count > MinLeafKeys) {
+                    BorrowFromRightLeaf(parent, i);
+                } else {
+                    MergeLeaves(parent, left ? i - 1 : i);
+                }
+            } else {
+                if (child->count >= MinInnerKeys) return;
+                if (left && left->count > MinInnerKeys) {
+                    BorrowFromLeftInner(parent, i);
+                } else if (right && right->count > MinInnerKeys) {
+                    BorrowFromRightInner(parent, i);
+                } else {
+                    MergeInners(parent, left ? i - 1 : i);
+                }
+            }
+        }
+
+        void BorrowFromLeftLeaf(Inner* parent, int i) {
+            Leaf* child = AsLeaf(parent->children[i]);
+            Leaf* left = AsLeaf(parent->children[i - 1]);
+            std::move_backward(child->keys, child->keys + child->count, child->keys + child->count + 1);
+            child->keys[0] = std::move(left->keys[left->count - 1]);
+            child->count++;
+            left->count--;
+            Seal(left->keys, left->count);
+            parent->keys[i - 1] = child->keys[0];
+        }
+
+        void BorrowFromRightLeaf(Inner* parent, int i) {
+            Leaf* child = AsLeaf(parent->children[i]);
+            Leaf* right = AsLeaf(parent->children[i + 1]);
+            child->keys[child->count++] = std::move(right->keys[0]);
+            std::move(right->keys + 1, right->keys + right->count, right->keys);
+            right->count--;
+            Seal(right->keys, right->count);
+            parent->keys[i] = right->keys[0];
+        }
+
+        void BorrowFromLeftInner(Inner* parent, int i) {
+            Inner* child = AsInner(parent->children[i]);
+            Inner* left = AsInner(parent->children[i - 1]);
+            std::move_backward(child->keys, child->keys + child->count, child->keys + child->count + 1);
+            std::copy_backward(child->children, child->children + child->count + 1, child->children + child->count + 2);
+            child->keys[0] = std::move(parent->keys[i - 1]);
+            child->children[0] = left->children[left->count];
+            child->count++;
+            parent->keys[i - 1] = std::move(left->keys[left->count - 1]);
+            left->count--;
+            Seal(left->keys, left->count);
+        }
+
+        void BorrowFromRightInner(Inner* parent, int i) {
+            Inner* child = AsInner(parent->children[i]);
+            Inner* right = AsInner(parent->children[i + 1]);
+            child->keys[child->count] = std::move(parent->keys[i]);
+            child->children[child->count + 1] = right->children[0];
+            child->count++;
+            parent->keys[i] = std::move(right->keys[0]);
+            std::move(right->keys + 1, right->keys + right->count, right->keys);
+            std::copy(right->children + 1, right->children + right->count + 1, right->children);
+            right->count--;
+            Seal(right->keys, right->count);
+        }
+
+        // Сливает children[i + 1] в children[i] и убирает разделитель keys[i].
+        void MergeLeaves(Inner* parent, int i) {
+            Leaf* left = AsLeaf(parent->children[i]);
+            Leaf* right = AsLeaf(parent->children[i + 1]);
+            std::move(right->keys, right->keys + right->count, left->keys + left->count);
+            left->count += right->count;
+            left->next = right->next;
+            if (right->next) right->next->prev = left;
+            else tail = left;
+            DeleteNode(right);
+            RemoveSeparator(parent, i);
+        }
+
+        void MergeInners(Inner* parent, int i) {
+            Inner* left = AsInner(parent->children[i]);
+            Inner* right = AsInner(parent->children[i + 1]);
+            left->keys[left->count] = std::move(parent->keys[i]);
+            std::move(right->keys, right->keys + right->count, left->keys + left->count + 1);
+            std::copy(right->children, right->children + right->count + 1, left->children + left->count + 1);
+            left->count += right->count + 1;
+            DeleteNode(right);
+            RemoveSeparator(parent, i);
+        }
+
+        void RemoveSeparator(Inner* parent, int i) {
+            std::move(parent->keys + i + 1, parent->keys + parent->count, parent->keys + i);
+            std::copy(parent->children + i + 2, parent->children + parent->count + 1, parent->children + i + 1);
+            parent->count--;
+            Seal(parent->keys, parent->count);
+        }
+
+        // Спуск к первому ключу, не меньшему k (Upper == false) или большему k (Upper == true).
+        // Если в листе такого нет, ответ - начало следующего листа.
+        template <bool Upper, typename K>
+        std::pair<Leaf*, int> BoundPosition(const K& k) const {
+            if (!root) return {nullptr, 0};
+            Node* current = root;
+            while (!current->leaf) {
+                Inner* inner = AsInner(current);
+                current = inner->children[Position<Upper>(inner->keys, inner->count, k)];
+            }
+            Leaf* leaf = AsLeaf(current);
+            int i = Position<Upper>(leaf->keys, leaf->count, k);
+            if (i == leaf->count) return {leaf->next, 0};
+            return {leaf, i};
+        }
+
+        template <typename K>
+        std::pair<Leaf*, int> FindPosition(const K& k) const {
+            auto [leaf, index] = BoundPosition<false>(k);
+            if (!leaf || CompareKeys(leaf->keys[index], k) != 0) return {nullptr, 0};
+            return {leaf, index};
+        }
+};
+
+#endif // BPLUSTREE_HPP
@@ -0,0 +1,753 @@
+#ifndef COMPACTAVL_HPP
+#define COMPACTAVL_HPP
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+#include "../../auxiliary/Iterator.hpp"
+#include "Tree.hpp"
+#include "TreeHelpers.hpp"
+#include "PathBuffer.hpp"
+
+// Узел компактного дерева: дети адресуются 32-битными индексами в общем массиве узлов.
+template <typename T>
+struct CompactNode {
+    static constexpr uint32_t Null = 0xFFFFFFFFu;
+
+    explicit CompactNode(const T& k) : key(k), left(Null), right(Null) {}
+
+    T key;
+    uint32_t left;
+    uint32_t right;
+};
+
+// Родительских ссылок нет, поэтому итератор хранит путь от корня до текущего узла.
+template <typename T, bool IsConst>
+class CompactTreeIterator : public IIterator<T, IsConst> {
+    public:
+        using value_type = typename IIterator<T, IsConst>::value_type;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = typename IIterator<T, IsConst>::reference;
+        using difference_type = typename IIterator<T, IsConst>::difference_type;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using Nodes = std::conditional_t<IsConst, const std::vector<CompactNode<T>>, std::vector<CompactNode<T>>>;
+
+        static constexpr uint32_t Null = CompactNode<T>::Null;
+
+        CompactTreeIterator(Nodes* n, const uint32_t* r, uint32_t node, const PathBuffer<uint32_t>& p)
+            : nodes(n), root(r), current(node), path(p) {}
+
+        bool HasNext() const override {
+            if (current == Null) return false;
+            if (Node(current).right != Null) return true;
+            uint32_t child = current;
+            for (int i = path.GetSize() - 1; i >= 0; i--) {
+                if (Node(path[i]).left == child) return true;
+                child = path[i];
+            }
+            return false;
+        }
+
+        bool HasPrev() const {
+            if (current == Null) return false;
+            if (Node(current).left != Null) return true;
+            uint32_t child = current;
+            for (int i = path.GetSize() - 1; i >= 0; i--) {
+                if (Node(path[i]).right == child) return true;
+                child = path[i];
+            }
+            return false;
+        }
+
+        reference Current() override {
+            return operator*();
+        }
+
+        void MoveNext() override {
+            operator++();
+        }
+
+        void MovePrev() {
+            operator--();
+        }
+
+        CompactTreeIterator& operator++() {
+            toNext();
+            return *this;
+        }
+
+        CompactTreeIterator operator++(int) {
+            CompactTreeIterator tmp = *this;
+            toNext();
+            return tmp;
+        }
+
+        CompactTreeIterator& operator--() {
+            toPrev();
+            return *this;
+        }
+
+        CompactTreeIterator operator--(int) {
+            CompactTreeIterator tmp = *this;
+            toPrev();
+            return tmp;
+        }
+
+        reference operator*() const {
+            if (current == Null) throw std::out_of_range("Iterator out of range");
+            return (*nodes)[current].key;
+        }
+
+        pointer operator->() const {
+            return &(operator*());
+        }
+
+        bool operator==(const CompactTreeIterator& other) const {
+            return current == other.current;
+        }
+
+        bool operator!=(const CompactTreeIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Nodes* nodes;
+        const uint32_t* root;
+        uint32_t current;
+        PathBuffer<uint32_t> path;
+
+        const CompactNode<T>& Node(uint32_t index) const {
+            return (*nodes)[index];
+        }
+
+        void toNext() {
+            if (current == Null) {
+                throw std::out_of_range("Iterator out of range");
+            }
+            if (Node(current).right != Null) {
+                path.Push(current);
+                current = Node(current).right;
+                while (Node(current).left != Null) {
+                    path.Push(current);
+                    current = Node(current).left;
+                }
+                return;
+            }
+            while (!path.IsEmpty()) {
+                uint32_t parent = path.Top();
+                path.Pop();
+                if (Node(parent).left == current) {
+                    current = parent;
+                    return;
+                }
+                current = parent;
+            }
+            current = Null;
+        }
+
+        void toPrev() {
+            if (current == Null) {
+                if (!root || *root == Null) {
+                    throw std::out_of_range("Iterator out of range");
+                }
+                current = *root;
+                while (Node(current).right != Null) {
+                    path.Push(current);
+                    current = Node(current).right;
+                }
+                return;
+            }
+            if (Node(current).left != Null) {
+                path.Push(current);
+                current = Node(current).left;
+                while (Node(current).right != Null) {
+                    path.Push(current);
+                    current = Node(current).right;
+                }
+                return;
+            }
+            while (!path.IsEmpty()) {
+                uint32_t parent = path.Top();
+                path.Pop();
+                if (Node(parent).right == current) {
+                    current = parent;
+                    return;
+                }
+                current = parent;
+            }
+            current = Null;
+        }
+};
+
+// AVL-дерево, узлы которого лежат подряд в одном векторе. Для int узел занимает 12 байт
+// и ещё байт высоты против 40 у Node<int>, зато нет родительских ссылок и порядковых статистик.
+// Высоты лежат в отдельном массиве: если упаковать их в старшие биты ссылок, маска на каждом
+// шаге спуска мешает компилятору выбрать ребёнка через cmov, и поиск становится вдвое медленнее.
+// Освобождённые ячейки переиспользуются через список, связанный по полю left.
+template <typename T, typename Compare = std::less<>>
+class CompactAVL_Tree : public Tree<T>, public IEnumerable<T> {
+    public:
+        using value_type = T;
+        using iterator = CompactTreeIterator<T, false>;
+        using const_iterator = CompactTreeIterator<T, true>;
+
+        static constexpr uint32_t Null = CompactNode<T>::Null;
+        static constexpr bool IsTransparent = IsTransparentCompare<Compare>;
+
+        iterator begin() {
+            PathBuffer<uint32_t> path;
+            return iterator(&nodes, &root, MinPath(path), path);
+        }
+        iterator end() {
+            return iterator(&nodes, &root, Null, PathBuffer<uint32_t>());
+        }
+        const_iterator begin() const {
+            return cbegin();
+        }
+        const_iterator end() const {
+            return cend();
+        }
+        const_iterator cbegin() const {
+            PathBuffer<uint32_t> path;
+            return const_iterator(&nodes, &root, MinPath(path), path);
+        }
+        const_iterator cend() const {
+            return const_iterator(&nodes, &root, Null, PathBuffer<uint32_t>());
+        }
+
+        std::unique_ptr<IIterator<T, false>> GetIterator() override {
+            return std::make_unique<iterator>(begin());
+        }
+        std::unique_ptr<IIterator<T, true>> GetConstIterator() const override {
+            return std::make_unique<const_iterator>(cbegin());
+        }
+
+        CompactAVL_Tree() : root(Null), freeList(Null), size(0) {}
+        CompactAVL_Tree(const CompactAVL_Tree& other) = default;
+        CompactAVL_Tree(CompactAVL_Tree&& other) noexcept
+            : nodes(std::move(other.nodes)), heights(std::move(other.heights)), root(other.root), freeList(other.freeList), size(other.size) {
+            other.nodes.clear();
+            other.heights.clear();
+            other.root = other.freeList = Null;
+            other.size = 0;
+        }
+
+        CompactAVL_Tree& operator=(const CompactAVL_Tree& other) = default;
+        CompactAVL_Tree& operator=(CompactAVL_Tree&& other) noexcept {
+            if (this == &other) return *this;
+            nodes = std::move(other.nodes);
+            heights = std::move(other.heights);
+            root = other.root;
+            freeList = other.freeList;
+            size = other.size;
+            other.nodes.clear();
+            other.heights.clear();
+            other.root = other.freeList = Null;
+            other.size = 0;
+            return *this;
+        }
+
+        // Строит дерево из отсортированного диапазона за O(n); узлы лежат в порядке возрастания ключей.
+        template <typename Range>
+        static CompactAVL_Tree* FromSorted(const Range& range) {
+            CompactAVL_Tree* result = new CompactAVL_Tree();
+            int count = (int)std::distance(std::begin(range), std::end(range));
+            result->nodes.reserve(count);
+            result->heights.reserve(count);
+            auto it = std::begin(range);
+            result->root = result->BuildSorted(it, count);
+            result->size = count;
+            return result;
+        }
+
+        int Size() const override {
+            return size;
+        }
+
+        bool IsEmpty() const {
+            return size == 0;
+        }
+
+        // Байты, занятые узлами (с учётом запаса ёмкости вектора), и сам объект дерева.
+        std::size_t MemoryUsage() const {
+            return nodes.capacity() * sizeof(CompactNode<T>) + heights.capacity() + sizeof(*this);
+        }
+
+        void ShrinkToFit() {
+            nodes.shrink_to_fit();
+            heights.shrink_to_fit();
+        }
+
+        T GetMin() const {
+            if (root == Null) throw std::out_of_range("Tree is empty");
+            uint32_t p = root;
+            while (nodes[p].left != Null) p = nodes[p].left;
+            return nodes[p].key;
+        }
+
+        T GetMax() const {
+            if (root == Null) throw std::out_of_range("Tree is empty");
+            uint32_t p = root;
+            while (nodes[p].right != Null) p = nodes[p].right;
+            return nodes[p].key;
+        }
+
+        void Insert(const T& k) override {
+            uint32_t node = NewNode(k);
+            const T& key = nodes[node].key;
+            PathBuffer<uint32_t> path;
+            uint32_t current = root;
+            bool toLeft = false;
+            while (current != Null) {
+                path.Push(current);
+                toLeft = Less(key, nodes[current].key);
+                current = toLeft ? nodes[current].left : nodes[current].right;
+            }
+            if (path.IsEmpty()) root = node;
+            else if (toLeft) nodes[path.Top()].left = node;
+            else nodes[path.Top()].right = node;
+            size++;
+            Rebalance(path);
+        }
+
+        bool Remove(const T& k) override {
+            return RemoveKey(k);
+        }
+
+        template <typename K> requires IsTransparent
+        bool Remove(const K& k) {
+            return RemoveKey(k);
+        }
+
+        bool Contains(const T& k) const override {
+            return FindNode(k) != Null;
+        }
+
+        template <typename K> requires IsTransparent
+        bool Contains(const K& k) const {
+            return FindNode(k) != Null;
+        }
+
+        iterator Find(const T& k) {
+            PathBuffer<uint32_t> path;
+            uint32_t node = FindPath(k, path);
+            return iterator(&nodes, &root, node, path);
+        }
+        const_iterator Find(const T& k) const {
+            PathBuffer<uint32_t> path;
+            uint32_t node = FindPath(k, path);
+            return const_iterator(&nodes, &root, node, path);
+        }
+
+        template <typename K> requires IsTransparent
+        iterator Find(const K& k) {
+            PathBuffer<uint32_t> path;
+            uint32_t node = FindPath(k, path);
+            return iterator(&nodes, &root, node, path);
+        }
+        template <typename K> requires IsTransparent
+        const_iterator Find(const K& k) const {
+            PathBuffer<uint32_t> path;
+            uint32_t node = FindPath(k, path);
+            return const_iterator(&nodes, &root, node, path);
+        }
+
+        // Обходы. Посетитель может вернуть VisitResult::Stop, тогда обход прерывается
+        // и функция возвращает false.
+        template <typename F>
+        bool PreOrder(F&& visit) const { // КЛП
+            PathBuffer<uint32_t> stack;
+            if (root != Null) stack.Push(root);
+
+            while (!stack.IsEmpty()) {
+                const CompactNode<T>& current = nodes[stack.Top()];
+                stack.Pop();
+                if (!VisitKey(visit, current.key)) return false;
+                if (current.right != Null) stack.Push(current.right);
+                if (current.left != Null) stack.Push(current.left);
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool ReversePreOrder(F&& visit) const { // КПЛ
+            PathBuffer<uint32_t> stack;
+            if (root != Null) stack.Push(root);
+
+            while (!stack.IsEmpty()) {
+                const CompactNode<T>& current = nodes[stack.Top()];
+                stack.Pop();
+                if (!VisitKey(visit, current.key)) return false;
+                if (current.left != Null) stack.Push(current.left);
+                if (current.right != Null) stack.Push(current.right);
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool InOrder(F&& visit) const { // ЛКП
+            return InOrderFrom(root, visit);
+        }
+
+        template <typename F>
+        bool ReverseInOrder(F&& visit) const { // ПКЛ
+            PathBuffer<uint32_t> stack;
+            uint32_t current = root;
+
+            while (current != Null || !stack.IsEmpty()) {
+                while (current != Null) {
+                    stack.Push(current);
+                    current = nodes[current].right;
+                }
+                current = stack.Top();
+                stack.Pop();
+                if (!VisitKey(visit, nodes[current].key)) return false;
+                current = nodes[current].left;
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool PostOrder(F&& visit) const { // ЛПК
+            PathBuffer<uint32_t> stack;
+            uint32_t current = root;
+            uint32_t lastVisited = Null;
+
+            while (current != Null || !stack.IsEmpty()) {
+                if (current != Null) {
+                    stack.Push(current);
+                    current = nodes[current].left;
+                } else {
+                    uint32_t peek = stack.Top();
+                    uint32_t right = nodes[peek].right;
+                    if (right != Null && lastVisited != right) {
+                        current = right;
+                    } else {
+                        if (!VisitKey(visit, nodes[peek].key)) return false;
+                        lastVisited = peek;
+                        stack.Pop();
+                    }
+                }
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool ReversePostOrder(F&& visit) const { // ПЛК
+            PathBuffer<uint32_t> stack;
+            uint32_t current = root;
+            uint32_t lastVisited = Null;
+
+            while (current != Null || !stack.IsEmpty()) {
+                if (current != Null) {
+                    stack.Push(current);
+                    current = nodes[current].right;
+                } else {
+                    uint32_t peek = stack.Top();
+                    uint32_t left = nodes[peek].left;
+                    if (left != Null && lastVisited != left) {
+                        current = left;
+                    } else {
+                        if (!VisitKey(visit, nodes[peek].key)) return false;
+                        lastVisited = peek;
+                        stack.Pop();
+                    }
+                }
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool Traverse(BypassType order, F&& visit) const {
+            switch (order) {
+                case BypassType::PreOrder : return PreOrder(visit);
+                case BypassType::ReversePreOrder : return ReversePreOrder(visit);
+                case BypassType::InOrder : return InOrder(visit);
+                case BypassType::ReverseInOrder : return ReverseInOrder(visit);
+                case BypassType::PostOrder : return PostOrder(visit);
+                case BypassType::ReversePostOrder : return ReversePostOrder(visit);
+                default:
+                    throw std::invalid_argument("Unknown Bypass type");
+            }
+        }
+
+        void PreOrder(std::function<void(const T&)> visit) const override {
+            PreOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReversePreOrder(std::function<void(const T&)> visit) const override {
+            ReversePreOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void InOrder(std::function<void(const T&)> visit) const override {
+            InOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReverseInOrder(std::function<void(const T&)> visit) const override {
+            ReverseInOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void PostOrder(std::function<void(const T&)> visit) const override {
+            PostOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReversePostOrder(std::function<void(const T&)> visit) const override {
+            ReversePostOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        bool Traverse(BypassType order, std::function<VisitResult(const T&)> visit) const override {
+            return Traverse<std::function<VisitResult(const T&)>&>(order, visit);
+        }
+
+        CompactAVL_Tree* GetSubTree(const T& k) const override {
+            std::vector<T> values;
+            uint32_t node = FindNode(k);
+            if (node != Null) InOrderFrom(node, [&values](const T& value) {values.push_back(value);});
+            return FromSorted(values);
+        }
+
+        CompactAVL_Tree* Concat(Tree<T>* other) const override {
+            CompactAVL_Tree* tree = dynamic_cast<CompactAVL_Tree*>(other);
+            if (!tree) {
+                CompactAVL_Tree* result = new CompactAVL_Tree(*this);
+                other->PreOrder([result](const T& value) {result->Insert(value);});
+                return result;
+            }
+            std::vector<T> values;
+            values.reserve(size + tree->size);
+            std::merge(cbegin(), cend(), tree->cbegin(), tree->cend(), std::back_inserter(values), Compare{});
+            return FromSorted(values);
+        }
+
+        CompactAVL_Tree* Clutch(Tree<T>* other) override {
+            std::vector<T> values;
+            values.reserve(other->Size());
+            other->InOrder([&values](const T& value) {values.push_back(value);});
+            for (const T& value : values) {
+                Insert(value);
+            }
+            return this;
+        }
+
+        static CompactAVL_Tree* fromString(const std::string& data) {
+            std::vector<T> values;
+            std::istringstream iss(data);
+            char c;
+            T value;
+            if (iss >> value) {
+                values.push_back(value);
+                while (iss >> c >> value) {
+                    if (c != ',') break;
+                    values.push_back(value);
+                }
+            }
+            if (!std::is_sorted(values.begin(), values.end(), Compare{})) std::stable_sort(values.begin(), values.end(), Compare{});
+            return FromSorted(values);
+        }
+
+        std::string toString(BypassType order = BypassType::InOrder) const {
+            std::ostringstream oss;
+            Traverse(order, [&oss](const T& value) {oss << value << " ";});
+            return oss.str();
+        }
+
+        void Clear() override {
+            nodes.clear();
+            nodes.shrink_to_fit();
+            heights.clear();
+            heights.shrink_to_fit();
+            root = freeList = Null;
+            size = 0;
+        }
+
+        ~CompactAVL_Tree() override = default;
+
+    private:
+        std::vector<CompactNode<T>> nodes;
+        std::vector<unsigned char> heights;
+        uint32_t root;
+        uint32_t freeList;
+        int size;
+
+        template <typename A, typename B>
+        static bool Less(const A& a, const B& b) {
+            return Compare{}(a, b);
+        }
+
+        unsigned Height(uint32_t p) const {
+            return p == Null ? 0 : heights[p];
+        }
+
+        int BFactor(uint32_t p) const {
+            return (int)Height(nodes[p].right) - (int)Height(nodes[p].left);
+        }
+
+        void FixHeight(uint32_t p) {
+            unsigned hl = Height(nodes[p].left);
+            unsigned hr = Height(nodes[p].right);
+            heights[p] = (unsigned char)((hl > hr ? hl : hr) + 1);
+        }
+
+        uint32_t RotateRight(uint32_t p) {
+            uint32_t q = nodes[p].left;
+            nodes[p].left = nodes[q].right;
+            nodes[q].right = p;
+            FixHeight(p);
+            FixHeight(q);
+            return q;
+        }
+
+        uint32_t RotateLeft(uint32_t q) {
+            uint32_t p = nodes[q].right;
+            nodes[q].right = nodes[p].left;
+            nodes[p].left = q;
+            FixHeight(q);
+            FixHeight(p);
+            return p;
+        }
+
+        uint32_t Balance(uint32_t p) {
+            FixHeight(p);
+            if (BFactor(p) == 2) {
+                if (BFactor(nodes[p].right) < 0) nodes[p].right = RotateRight(nodes[p].right);
+                return RotateLeft(p);
+            }
+            if (BFactor(p) == -2) {
+                if (BFactor(nodes[p].left) > 0) nodes[p].left = RotateLeft(nodes[p].left);
+                return RotateRight(p);
+            }
+            return p;
+        }
+
+        // Балансирует путь снизу вверх; выше поддерева, высота которого не изменилась, идти незачем.
+        void Rebalance(PathBuffer<uint32_t>& path) {
+            for (int i = path.GetSize() - 1; i >= 0; i--) {
+                uint32_t p = path[i];
+                unsigned height = heights[p];
+                uint32_t balanced = Balance(p);
+                if (i == 0) root = balanced;
+                else if (nodes[path[i - 1]].left == p) nodes[path[i - 1]].left = balanced;
+                else nodes[path[i - 1]].right = balanced;
+                if (heights[balanced] == height) break;
+            }
+        }
+
+        uint32_t NewNode(const T& k) {
+            if (freeList != Null) {
+                uint32_t index = freeList;
+                freeList = nodes[index].left;
+                nodes[index].key = k;
+                nodes[index].left = Null;
+                nodes[index].right = Null;
+                heights[index] = 1;
+                return index;
+            }
+            if (nodes.size() >= Null) throw std::length_error("CompactAVL_Tree is full");
+            nodes.emplace_back(k);
+            heights.push_back(1);
+            return (uint32_t)nodes.size() - 1;
+        }
+
+        void FreeNode(uint32_t index) {
+            nodes[index].left = freeList;
+            freeList = index;
+        }
+
+        template <typename K>
+        uint32_t FindNode(const K& k) const {
+            uint32_t current = root;
+            while (current != Null) {
+                const CompactNode<T>& node = nodes[current];
+                int order = ThreeWayCompare<Compare>(k, node.key);
+                if (order == 0) return current;
+                current = order < 0 ? node.left : node.right;
+            }
+            return Null;
+        }
+
+        template <typename K>
+        uint32_t FindPath(const K& k, PathBuffer<uint32_t>& path) const {
+            uint32_t current = root;
+            while (current != Null) {
+                int order = ThreeWayCompare<Compare>(k, nodes[current].key);
+                if (order == 0) return current;
+                path.Push(current);
+                current = order < 0 ? nodes[current].left : nodes[current].right;
+            }
+            return Null;
+        }
+
+        uint32_t MinPath(PathBuffer<uint32_t>& path) const {
+            uint32_t current = root;
+            if (current == Null) return Null;
+            while (nodes[current].left != Null) {
+                path.Push(current);
+                current = nodes[current].left;
+            }
+            return current;
+        }
+
+        // Узел с двумя детьми получает ключ своего преемника, а удаляется ячейка преемника.
+        template <typename K>
+        bool RemoveKey(const K& k) {
+            PathBuffer<uint32_t> path;
+            uint32_t current = FindPath(k, path);
+            if (current == Null) return false;
+            if (nodes[current].left != Null && nodes[current].right != Null) {
+                uint32_t target = current;
+                path.Push(target);
+                current = nodes[target].right;
+                while (nodes[current].left != Null) {
+                    path.Push(current);
+                    current = nodes[current].left;
+                }
+                nodes[target].key = std::move(nodes[current].key);
+            }
+            uint32_t child = nodes[current].left != Null ? nodes[current].left : nodes[current].right;
+            if (path.IsEmpty()) root = child;
+            else if (nodes[path.Top()].left == current) nodes[path.Top()].left = child;
+            else nodes[path.Top()].right = child;
+            FreeNode(current);
+            size--;
+            Rebalance(path);
+            return true;
+        }
+
+        template <typename F>
+        bool InOrderFrom(uint32_t start, F&& visit) const {
+            PathBuffer<uint32_t> stack;
+            uint32_t current = start;
+
+            while (current != Null || !stack.IsEmpty()) {
+                while (current != Null) {
+                    stack.Push(current);
+                    current = nodes[current].left;
+                }
+                current = stack.Top();
+                stack.Pop();
+                if (!VisitKey(visit, nodes[current].key)) return false;
+                current = nodes[current].right;
+            }
+            return true;
+        }
+
+        template <typename It>
+        uint32_t BuildSorted(It& it, int count) {
+            if (count <= 0) return Null;
+            uint32_t left = BuildSorted(it, count / 2);
+            uint32_t node = NewNode(*it);
+            ++it;
+            uint32_t right = BuildSorted(it, count - count / 2 - 1);
+            nodes[node].left = left;
+            nodes[node].right = right;
+            FixHeight(node);
+            return node;
+        }
+};
+
+#endif // COMPACTAVL_HPP
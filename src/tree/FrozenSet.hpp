@@ -0,0 +1,479 @@
+#ifndef FROZENSET_HPP
+#define FROZENSET_HPP
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include "TreeHelpers.hpp"
+#include "../../auxiliary/Iterator.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define FROZENSET_AVX2 1
+#endif
+
+// Ключи неизменяемого множества лежат в порядке Эйтцингера (обход дерева в ширину):
+// у элемента с индексом k дети имеют индексы 2k и 2k + 1, ячейка 0 не используется.
+// Индекс 0 у итератора означает конец.
+template <typename T, bool IsConst>
+class FrozenSetIterator : public IIterator<T, IsConst> {
+    public:
+        using value_type = typename IIterator<T, IsConst>::value_type;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = typename IIterator<T, IsConst>::reference;
+        using difference_type = typename IIterator<T, IsConst>::difference_type;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        FrozenSetIterator(pointer d, std::size_t s, std::size_t k) : data(d), size(s), current(k) {}
+
+        bool HasNext() const override {
+            return current != 0 && Successor(current) != 0;
+        }
+
+        bool HasPrev() const {
+            return current != 0 && Predecessor(current) != 0;
+        }
+
+        reference Current() override {
+            return operator*();
+        }
+
+        void MoveNext() override {
+            operator++();
+        }
+
+        void MovePrev() {
+            operator--();
+        }
+
+        FrozenSetIterator& operator++() {
+            toNext();
+            return *this;
+        }
+
+        FrozenSetIterator operator++(int) {
+            FrozenSetIterator tmp = *this;
+            toNext();
+            return tmp;
+        }
+
+        FrozenSetIterator& operator--() {
+            toPrev();
+            return *this;
+        }
+
+        FrozenSetIterator operator--(int) {
+            FrozenSetIterator tmp = *this;
+            toPrev();
+            return tmp;
+        }
+
+        reference operator*() const {
+            if (current == 0) throw std::out_of_range("Iterator out of range");
+            return data[current];
+        }
+
+        pointer operator->() const {
+            return &(operator*());
+        }
+
+        bool operator==(const FrozenSetIterator& other) const {
+            return current == other.current;
+        }
+
+        bool operator!=(const FrozenSetIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        pointer data;
+        std::size_t size;
+        std::size_t current;
+
+        void toNext() {
+            if (current == 0) {
+                throw std::out_of_range("Iterator out of range");
+            }
+            current = Successor(current);
+        }
+
+        void toPrev() {
+            if (current == 0) {
+                if (size == 0) {
+                    throw std::out_of_range("Iterator out of range");
+                }
+                current = 1;
+                while (2 * current + 1 <= size) current = 2 * current + 1;
+            } else {
+                current = Predecessor(current);
+            }
+        }
+
+        std::size_t Successor(std::size_t k) const {
+            if (2 * k + 1 <= size) {
+                k = 2 * k + 1;
+                while (2 * k <= size) k = 2 * k;
+                return k;
+            }
+            while (k & 1) k >>= 1;
+            return k >> 1;
+        }
+
+        std::size_t Predecessor(std::size_t k) const {
+            if (2 * k <= size) {
+                k = 2 * k;
+                while (2 * k + 1 <= size) k = 2 * k + 1;
+                return k;
+            }
+            while (k && !(k & 1)) k >>= 1;
+            return k >> 1;
+        }
+};
+
+// Неизменяемое множество для чтения: поиск спускается по массиву без ветвлений,
+// заранее подгружая кэш-линию с потомками на несколько уровней ниже.
+template <typename T, typename Compare = std::less<>>
+class FrozenSet : public IEnumerable<T> {
+    public:
+        using value_type = T;
+        using iterator = FrozenSetIterator<T, false>;
+        using const_iterator = FrozenSetIterator<T, true>;
+
+        static constexpr bool IsTransparent = IsTransparentCompare<Compare>;
+
+        iterator begin() {
+            return iterator(data.data(), size, First());
+        }
+
+        iterator end() {
+            return iterator(data.data(), size, 0);
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+        const_iterator cbegin() const {
+            return const_iterator(data.data(), size, First());
+        }
+
+        const_iterator cend() const {
+            return const_iterator(data.data(), size, 0);
+        }
+
+        std::unique_ptr<IIterator<T, false>> GetIterator() override {
+            return std::make_unique<iterator>(begin());
+        }
+
+        std::unique_ptr<IIterator<T, true>> GetConstIterator() const override {
+            return std::make_unique<const_iterator>(cbegin());
+        }
+
+        FrozenSet() : size(0) {}
+
+        // Повторяющиеся подряд ключи отбрасываются, как в Set::FromSorted.
+        template <typename Range>
+        static FrozenSet* FromSorted(const Range& range) {
+            std::vector<T> values;
+            for (const T& value : range) {
+                if (values.empty() || ThreeWayCompare<Compare>(values.back(), value) != 0) values.push_back(value);
+            }
+            FrozenSet* result = new FrozenSet();
+            result->size = values.size();
+            if (!values.empty()) {
+                result->data.assign(values.size() + 1, values.front());
+                auto it = values.cbegin();
+                result->Layout(it, 1);
+            }
+            return result;
+        }
+
+        bool operator==(const FrozenSet& other) const {
+            if (size != other.size) return false;
+            const_iterator it = other.cbegin();
+            return InOrder([&it](const T& value) {
+                if (ThreeWayCompare<Compare>(value, *it) != 0) return VisitResult::Stop;
+                ++it;
+                return VisitResult::Continue;
+            });
+        }
+        bool operator!=(const FrozenSet& other) const {
+            return !(*this == other);
+        }
+
+        int Size() const {
+            return (int)size;
+        }
+
+        bool IsEmpty() const {
+            return size == 0;
+        }
+
+        T GetMin() const {
+            if (size == 0) throw std::out_of_range("Set is empty");
+            return data[First()];
+        }
+
+        T GetMax() const {
+            if (size == 0) throw std::out_of_range("Set is empty");
+            std::size_t k = 1;
+            while (2 * k + 1 <= size) k = 2 * k + 1;
+            return data[k];
+        }
+
+        bool Contains(const T& value) const {
+            return FindIndex(value) != 0;
+        }
+
+        template <typename K> requires IsTransparent
+        bool Contains(const K& value) const {
+            return FindIndex(value) != 0;
+        }
+
+        // result[i] = Contains(values[i]). Для 32-битных знаковых ключей с std::less<>
+        // на процессорах с AVX2 восемь спусков идут одновременно через gather,
+        // иначе спуски чередуются по восемь, чтобы промахи кэша перекрывались.
+        void ContainsMany(std::span<const T> values, std::span<bool> result) const {
+            if (result.size() < values.size()) throw std::invalid_argument("Result span is too short");
+            int count = (int)values.size();
+#ifdef FROZENSET_AVX2
+            if constexpr (GatherProbe) {
+                if (size < (std::size_t(1) << 30) && __builtin_cpu_supports("avx2")) {
+                    ContainsManyAVX2(values.data(), count, result.data());
+                    return;
+                }
+            }
+#endif
+            int i = 0;
+            for (; i + Batch <= count; i += Batch) {
+                std::size_t k[Batch];
+                std::fill(k, k + Batch, std::size_t(1));
+                for (int level = 0; level < Levels(); level++) {
+                    for (int j = 0; j < Batch; j++) {
+                        std::size_t at = k[j] <= size ? k[j] : 0;
+                        Prefetch(at);
+                        std::size_t next = 2 * k[j] + (std::size_t)Less(data[at], values[i + j]);
+                        k[j] = k[j] <= size ? next : k[j];
+                    }
+                }
+                for (int j = 0; j < Batch; j++) {
+                    result[i + j] = Matches(Settle(k[j]), values[i + j]);
+                }
+            }
+            for (; i < count; i++) {
+                result[i] = Contains(values[i]);
+            }
+        }
+
+        const_iterator Find(const T& value) const {
+            return const_iterator(data.data(), size, FindIndex(value));
+        }
+
+        template <typename K> requires IsTransparent
+        const_iterator Find(const K& value) const {
+            return const_iterator(data.data(), size, FindIndex(value));
+        }
+
+        const_iterator LowerBound(const T& value) const {
+            return const_iterator(data.data(), size, LowerBoundIndex(value));
+        }
+
+        const_iterator UpperBound(const T& value) const {
+            return const_iterator(data.data(), size, UpperBoundIndex(value));
+        }
+
+        const_iterator Floor(const T& value) const {
+            const_iterator it = UpperBound(value);
+            if (it == cbegin()) return cend();
+            return --it;
+        }
+
+        const_iterator Ceiling(const T& value) const {
+            return LowerBound(value);
+        }
+
+        template <typename F>
+        void ForEachInRange(const T& lo, const T& hi, F&& visit) const {
+            for (const_iterator it = LowerBound(lo); it != cend() && Less(*it, hi); ++it) {
+                if (!VisitKey(visit, *it)) return;
+            }
+        }
+
+        template <typename F>
+        bool InOrder(F&& visit) const {
+            for (const T& value : *this) {
+                if (!VisitKey(visit, value)) return false;
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool ReverseInOrder(F&& visit) const {
+            if (size == 0) return true;
+            const_iterator it = cend();
+            do {
+                --it;
+                if (!VisitKey(visit, *it)) return false;
+            } while (it != cbegin());
+            return true;
+        }
+
+        template <typename F>
+        const_iterator FindFirst(F&& pred) const {
+            for (const_iterator it = cbegin(); it != cend(); ++it) {
+                if (pred(*it)) return it;
+            }
+            return cend();
+        }
+
+        // Байты массива ключей (с учётом запаса ёмкости) и самого объекта.
+        std::size_t MemoryUsage() const {
+            return data.capacity() * sizeof(T) + sizeof(*this);
+        }
+
+        std::string toString() const {
+            std::ostringstream oss;
+            oss << "[";
+            bool first = true;
+            InOrder([&oss, &first](const T& value) {
+                if(!first) oss << ", ";
+                oss << value;
+                first = false;
+            });
+            oss << "]";
+            return oss.str();
+        }
+
+    private:
+        std::vector<T> data;
+        std::size_t size;
+
+        static constexpr int Batch = 8;
+
+        // Потомки узла k на глубине d занимают индексы [k * 2^d, k * 2^d + 2^d),
+        // поэтому подгружается блок из стольких потомков, сколько ключей помещается в кэш-линию.
+        static constexpr std::size_t PrefetchSpan() {
+            std::size_t span = 2;
+            while (span * 2 * sizeof(T) <= 64) span *= 2;
+            return span;
+        }
+
+#ifdef FROZENSET_AVX2
+        static constexpr bool GatherProbe = std::is_same_v<Compare, std::less<>> && std::is_integral_v<T>
+            && std::is_signed_v<T> && sizeof(T) == 4;
+#endif
+
+        template <typename A, typename B>
+        static bool Less(const A& a, const B& b) {
+            return Compare{}(a, b);
+        }
+
+        std::size_t First() const {
+            if (size == 0) return 0;
+            std::size_t k = 1;
+            while (2 * k <= size) k = 2 * k;
+            return k;
+        }
+
+        // Число уровней дерева: после стольких шагов спуск из корня гарантированно выходит за size.
+        int Levels() const {
+            int levels = 0;
+            for (std::size_t n = size; n; n >>= 1) levels++;
+            return levels;
+        }
+
+        void Prefetch(std::size_t k) const {
+            __builtin_prefetch(data.data() + std::min(k * PrefetchSpan(), size));
+        }
+
+        // Спуск вышел за массив в индекс k; последний поворот направо, после которого шли только
+        // налево, указывает на искомый узел. Отбрасываем хвост из единиц и ещё один бит.
+        static std::size_t Settle(std::size_t k) {
+            return k >> __builtin_ffsll((long long)~k);
+        }
+
+        template <typename K>
+        bool Matches(std::size_t k, const K& value) const {
+            return k != 0 && ThreeWayCompare<Compare>(data[k], value) == 0;
+        }
+
+        template <typename K>
+        std::size_t LowerBoundIndex(const K& value) const {
+            std::size_t k = 1;
+            while (k <= size) {
+                Prefetch(k);
+                k = 2 * k + (std::size_t)Less(data[k], value);
+            }
+            return Settle(k);
+        }
+
+        template <typename K>
+        std::size_t UpperBoundIndex(const K& value) const {
+            std::size_t k = 1;
+            while (k <= size) {
+                Prefetch(k);
+                k = 2 * k + (std::size_t)!Less(value, data[k]);
+            }
+            return Settle(k);
+        }
+
+        template <typename K>
+        std::size_t FindIndex(const K& value) const {
+            std::size_t k = LowerBoundIndex(value);
+            return Matches(k, value) ? k : 0;
+        }
+
+        template <typename It>
+        void Layout(It& it, std::size_t k) {
+            if (k > size) return;
+            Layout(it, 2 * k);
+            data[k] = *it;
+            ++it;
+            Layout(it, 2 * k + 1);
+        }
+
+#ifdef FROZENSET_AVX2
+        // Индексы неактивных дорожек (уже вышедших за массив) маскируются и в gather, и в шаге.
+        __attribute__((target("avx2")))
+        void ContainsManyAVX2(const T* values, int count, bool* result) const {
+            const int* keys = reinterpret_cast<const int*>(data.data());
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i bound = _mm256_set1_epi32((int)size + 1);
+            int levels = Levels();
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+                __m256i k = one;
+                for (int level = 0; level < levels; level++) {
+                    __m256i active = _mm256_cmpgt_epi32(bound, k);
+                    __m256i key = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), keys, k, active, 4);
+                    __m256i less = _mm256_and_si256(_mm256_cmpgt_epi32(x, key), active);
+                    __m256i next = _mm256_sub_epi32(_mm256_add_epi32(k, k), less);
+                    k = _mm256_blendv_epi8(k, next, active);
+                }
+                alignas(32) uint32_t lanes[8];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), k);
+                for (int j = 0; j < 8; j++) {
+                    result[i + j] = Matches(Settle(lanes[j]), values[i + j]);
+                }
+            }
+            for (; i < count; i++) {
+                result[i] = Contains(values[i]);
+            }
+        }
+#endif
+};
+
+#endif // FROZENSET_HPP
@@ -0,0 +1,129 @@
+#ifndef NODEALLOCATOR_HPP
+#define NODEALLOCATOR_HPP
+
+#include <new>
+#include <utility>
+#include <cstddef>
+
+// Политики выделения узлов дерева. Create/Destroy работают с одним узлом,
+// Release освобождает всю память разом (деструкторы узлов не вызываются),
+// Reserve готовит место под count узлов подряд.
+
+template <typename N>
+class HeapAllocator {
+    public:
+        static constexpr bool BulkRelease = false;
+
+        HeapAllocator() = default;
+        HeapAllocator(const HeapAllocator&) = delete;
+        HeapAllocator& operator=(const HeapAllocator&) = delete;
+
+        template <typename... Args>
+        N* Create(Args&&... args) {
+            return new N(std::forward<Args>(args)...);
+        }
+
+        void Destroy(N* p) {
+            delete p;
+        }
+
+        void Reserve(int) {}
+
+        void Release() {}
+
+        void Swap(HeapAllocator&) {}
+};
+
+template <typename N, int SlabSize = 256>
+class SlabAllocator {
+    public:
+        static constexpr bool BulkRelease = true;
+
+        SlabAllocator() : slabs(nullptr), freeList(nullptr), used(0), capacity(0) {}
+        SlabAllocator(const SlabAllocator&) = delete;
+        SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+        template <typename... Args>
+        N* Create(Args&&... args) {
+            void* place;
+            if (freeList) {
+                place = freeList;
+                freeList = freeList->next;
+            } else {
+                if (used == capacity) Grow(SlabSize);
+                place = Storage(slabs) + used * sizeof(N);
+                used++;
+            }
+            try {
+                return ::new (place) N(std::forward<Args>(args)...);
+            } catch (...) {
+                freeList = ::new (place) FreeSlot{freeList};
+                throw;
+            }
+        }
+
+        void Destroy(N* p) {
+            p->~N();
+            freeList = ::new (static_cast<void*>(p)) FreeSlot{freeList};
+        }
+
+        // Следующие count узлов (без учёта свободного списка) лягут в один непрерывный блок.
+        void Reserve(int count) {
+            if (capacity - used < count) Grow(count > SlabSize ? count : SlabSize);
+        }
+
+        void Release() {
+            while (slabs) {
+                Slab* next = slabs->next;
+                ::operator delete(slabs, std::align_val_t(Alignment));
+                slabs = next;
+            }
+            freeList = nullptr;
+            used = 0;
+            capacity = 0;
+        }
+
+        void Swap(SlabAllocator& other) {
+            std::swap(slabs, other.slabs);
+            std::swap(freeList, other.freeList);
+            std::swap(used, other.used);
+            std::swap(capacity, other.capacity);
+        }
+
+        ~SlabAllocator() {
+            Release();
+        }
+
+    private:
+        struct FreeSlot {
+            FreeSlot* next;
+        };
+
+        struct Slab {
+            Slab* next;
+        };
+
+        static_assert(sizeof(N) >= sizeof(FreeSlot) && alignof(N) >= alignof(FreeSlot), "Node is too small for a free list slot");
+
+        static constexpr std::size_t Alignment = alignof(N) > alignof(Slab) ? alignof(N) : alignof(Slab);
+        static constexpr std::size_t HeaderSize = (sizeof(Slab) + Alignment - 1) / Alignment * Alignment;
+
+        Slab* slabs;
+        FreeSlot* freeList;
+        int used;
+        int capacity;
+
+        static unsigned char* Storage(Slab* slab) {
+            return reinterpret_cast<unsigned char*>(slab) + HeaderSize;
+        }
+
+        void Grow(int count) {
+            void* memory = ::operator new(HeaderSize + count * sizeof(N), std::align_val_t(Alignment));
+            Slab* slab = ::new (memory) Slab{slabs};
+            slabs = slab;
+            used = 0;
+            capacity = count;
+        }
+};
+
+#endif // NODEALLOCATOR_HPP
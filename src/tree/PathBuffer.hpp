@@ -0,0 +1,50 @@
+#ifndef PATHBUFFER_HPP
+#define PATHBUFFER_HPP
+
+#include <stdexcept>
+
+// Стек фиксированной ёмкости без выделений памяти для хранения пути спуска.
+// Высота AVL-дерева не превышает 1.44 * log2(n + 2), так что 64 уровней хватает
+// для любого размера, представимого в int.
+template <typename T, int Capacity = 64>
+class PathBuffer {
+    public:
+        PathBuffer() : count(0) {}
+
+        void Push(const T& value) {
+            if (count == Capacity) throw std::overflow_error("Path buffer overflow");
+            items[count++] = value;
+        }
+
+        T Top() const {
+            if (IsEmpty()) throw std::out_of_range("Path buffer is empty");
+            return items[count - 1];
+        }
+
+        void Pop() {
+            if (IsEmpty()) throw std::out_of_range("Path buffer is empty");
+            count--;
+        }
+
+        bool IsEmpty() const {
+            return count == 0;
+        }
+
+        int GetSize() const {
+            return count;
+        }
+
+        T& operator[](int index) {
+            return items[index];
+        }
+
+        const T& operator[](int index) const {
+            return items[index];
+        }
+
+    private:
+        T items[Capacity];
+        int count;
+};
+
+#endif // PATHBUFFER_HPP
@@ -0,0 +1,1048 @@
+#ifndef PERSISTENTAVL_HPP
+#define PERSISTENTAVL_HPP
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <span>
+#include <atomic>
+#include <stdexcept>
+#include "../../auxiliary/Iterator.hpp"
+#include "Tree.hpp"
+#include "TreeHelpers.hpp"
+#include "PathBuffer.hpp"
+#include "FrozenSet.hpp"
+
+// Узел может входить сразу в несколько версий дерева; refs - число ссылок на него
+// из корней версий и из родителей.
+template <typename T>
+struct PersistentNode {
+    explicit PersistentNode(const T& k) : key(k), height(1), size(1), left(nullptr), right(nullptr), refs(1) {}
+    explicit PersistentNode(T&& k) : key(std::move(k)), height(1), size(1), left(nullptr), right(nullptr), refs(1) {}
+
+    T key;
+    unsigned char height;
+    int size;
+    PersistentNode* left;
+    PersistentNode* right;
+    std::atomic<int> refs;
+};
+
+// Узел бывает общим для нескольких версий, поэтому родительских ссылок нет и итератор
+// хранит путь от корня. Ключи через неконстантный итератор менять нельзя: их видят и снимки.
+template <typename T, bool IsConst>
+class PersistentTreeIterator : public IIterator<T, IsConst> {
+    public:
+        using value_type = typename IIterator<T, IsConst>::value_type;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = typename IIterator<T, IsConst>::reference;
+        using difference_type = typename IIterator<T, IsConst>::difference_type;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using Node = PersistentNode<T>;
+
+        PersistentTreeIterator(Node* const* r, Node* node, const PathBuffer<Node*>& p)
+            : root(r), current(node), path(p) {}
+
+        bool HasNext() const override {
+            if (!current) return false;
+            if (current->right) return true;
+            Node* child = current;
+            for (int i = path.GetSize() - 1; i >= 0; i--) {
+                if (path[i]->left == child) return true;
+                child = path[i];
+            }
+            return false;
+        }
+
+        bool HasPrev() const {
+            if (!current) return false;
+            if (current->left) return true;
+            Node* child = current;
+            for (int i = path.GetSize() - 1; i >= 0; i--) {
+                if (path[i]->right == child) return true;
+                child = path[i];
+            }
+            return false;
+        }
+
+        reference Current() override {
+            return operator*();
+        }
+
+        void MoveNext() override {
+            operator++();
+        }
+
+        void MovePrev() {
+            operator--();
+        }
+
+        PersistentTreeIterator& operator++() {
+            toNext();
+            return *this;
+        }
+
+        PersistentTreeIterator operator++(int) {
+            PersistentTreeIterator tmp = *this;
+            toNext();
+            return tmp;
+        }
+
+        PersistentTreeIterator& operator--() {
+            toPrev();
+            return *this;
+        }
+
+        PersistentTreeIterator operator--(int) {
+            PersistentTreeIterator tmp = *this;
+            toPrev();
+            return tmp;
+        }
+
+        reference operator*() const {
+            if (!current) throw std::out_of_range("Iterator out of range");
+            return current->key;
+        }
+
+        pointer operator->() const {
+            return &(operator*());
+        }
+
+        bool operator==(const PersistentTreeIterator& other) const {
+            return current == other.current;
+        }
+
+        bool operator!=(const PersistentTreeIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Node* const* root;
+        Node* current;
+        PathBuffer<Node*> path;
+
+        void toNext() {
+            if (!current) {
+                throw std::out_of_range("Iterator out of range");
+            }
+            if (current->right) {
+                path.Push(current);
+                current = current->right;
+                while (current->left) {
+                    path.Push(current);
+                    current = current->left;
+                }
+                return;
+            }
+            while (!path.IsEmpty()) {
+                Node* parent = path.Top();
+                path.Pop();
+                if (parent->left == current) {
+                    current = parent;
+                    return;
+                }
+                current = parent;
+            }
+            current = nullptr;
+        }
+
+        void toPrev() {
+            if (!current) {
+                if (!root || !*root) {
+                    throw std::out_of_range("Iterator out of range");
+                }
+                current = *root;
+                while (current->right) {
+                    path.Push(current);
+                    current = current->right;
+                }
+                return;
+            }
+            if (current->left) {
+                path.Push(current);
+                current = current->left;
+                while (current->right) {
+                    path.Push(current);
+                    current = current->right;
+                }
+                return;
+            }
+            while (!path.IsEmpty()) {
+                Node* parent = path.Top();
+                path.Pop();
+                if (parent->right == current) {
+                    current = parent;
+                    return;
+                }
+                current = parent;
+            }
+            current = nullptr;
+        }
+};
+
+// Персистентное AVL-дерево. Вставка и удаление копируют только узлы на пути от корня
+// (O(log n)), остальное дерево делится со старыми версиями через счётчики ссылок.
+// Копия дерева и Snapshot() стоят O(1): они лишь захватывают корень. Узел, которым
+// владеет одна версия, меняется на месте, так что без снимков дерево не копирует ничего.
+// Снимок изменяемого дерева берётся в потоке писателя; снимок опубликованной версии,
+// которую больше никто не меняет, можно брать из любого потока - он лишь атомарно
+// увеличивает счётчик ссылок корня. Снимок можно читать из других потоков
+// одновременно с изменениями исходного дерева. Версия освобождается вместе
+// с последним деревом, которое на неё ссылается.
+template <typename T, typename Compare = std::less<>>
+class PersistentAVL_Tree : public Tree<T>, public IEnumerable<T> {
+    private:
+        using Node = PersistentNode<T>;
+
+    public:
+        using value_type = T;
+        using iterator = PersistentTreeIterator<T, false>;
+        using const_iterator = PersistentTreeIterator<T, true>;
+
+        static constexpr bool IsTransparent = IsTransparentCompare<Compare>;
+
+        template <typename U>
+        using Rebind = PersistentAVL_Tree<U, Compare>;
+
+        template <typename A, typename B>
+        static int CompareKeys(const A& a, const B& b) {
+            return ThreeWayCompare<Compare>(a, b);
+        }
+
+        iterator begin() {
+            PathBuffer<Node*> path;
+            Node* node = MinPath(path);
+            return iterator(&root, node, path);
+        }
+        iterator end() {
+            return iterator(&root, nullptr, PathBuffer<Node*>());
+        }
+        const_iterator begin() const {
+            return cbegin();
+        }
+        const_iterator end() const {
+            return cend();
+        }
+        const_iterator cbegin() const {
+            PathBuffer<Node*> path;
+            Node* node = MinPath(path);
+            return const_iterator(&root, node, path);
+        }
+        const_iterator cend() const {
+            return const_iterator(&root, nullptr, PathBuffer<Node*>());
+        }
+
+        std::unique_ptr<IIterator<T, false>> GetIterator() override {
+            return std::make_unique<iterator>(begin());
+        }
+        std::unique_ptr<IIterator<T, true>> GetConstIterator() const override {
+            return std::make_unique<const_iterator>(cbegin());
+        }
+
+        PersistentAVL_Tree() : root(nullptr) {}
+        PersistentAVL_Tree(const PersistentAVL_Tree& other) : root(Retain(other.root)) {}
+        PersistentAVL_Tree(PersistentAVL_Tree&& other) noexcept : root(other.root) {
+            other.root = nullptr;
+        }
+
+        PersistentAVL_Tree& operator=(const PersistentAVL_Tree& other) {
+            Node* shared = Retain(other.root);
+            Release(root);
+            root = shared;
+            return *this;
+        }
+
+        PersistentAVL_Tree& operator=(PersistentAVL_Tree&& other) noexcept {
+            if (this == &other) return *this;
+            Release(root);
+            root = other.root;
+            other.root = nullptr;
+            return *this;
+        }
+
+        // Строит дерево из отсортированного диапазона за O(n).
+        template <typename Range>
+        static PersistentAVL_Tree* FromSorted(const Range& range) {
+            PersistentAVL_Tree* result = new PersistentAVL_Tree();
+            int count = (int)std::distance(std::begin(range), std::end(range));
+            auto it = std::begin(range);
+            result->root = BuildSorted(it, count);
+            return result;
+        }
+
+        // Версия дерева на текущий момент за O(1); дальнейшие изменения её не затрагивают.
+        PersistentAVL_Tree* Snapshot() const {
+            return new PersistentAVL_Tree(*this);
+        }
+
+        int Size() const override {
+            return SubtreeSize(root);
+        }
+
+        bool IsEmpty() const {
+            return root == nullptr;
+        }
+
+        T GetMin() const {
+            if (!root) throw std::out_of_range("Tree is empty");
+            Node* p = root;
+            while (p->left) p = p->left;
+            return p->key;
+        }
+
+        T GetMax() const {
+            if (!root) throw std::out_of_range("Tree is empty");
+            Node* p = root;
+            while (p->right) p = p->right;
+            return p->key;
+        }
+
+        void Insert(const T& k) override {
+            root = InsertNode(root, k);
+        }
+
+        void Insert(T&& k) {
+            root = InsertNode(root, std::move(k));
+        }
+
+        // Вставка для множеств: false, если такой ключ уже есть, и тогда ни один узел не копируется.
+        bool InsertUnique(const T& k) {
+            return InsertUniqueKey(k);
+        }
+
+        bool InsertUnique(T&& k) {
+            return InsertUniqueKey(std::move(k));
+        }
+
+        // Большая относительно дерева пачка сливается с ним и дерево строится заново
+        // за O(n + m), маленькая вставляется по ключу.
+        template <typename Range>
+        void InsertMany(const Range& range) {
+            std::vector<T> batch(std::begin(range), std::end(range));
+            MergeBatch(batch, false);
+        }
+
+        // То же для множеств: ключи, повторяющиеся в пачке или уже лежащие в дереве, пропускаются.
+        template <typename Range>
+        void InsertManyUnique(const Range& range) {
+            std::vector<T> batch(std::begin(range), std::end(range));
+            MergeBatch(batch, true);
+        }
+
+        // Отсутствующий ключ ничего не копирует.
+        bool Remove(const T& k) override {
+            return RemoveKey(k);
+        }
+        template <typename K> requires IsTransparent
+        bool Remove(const K& k) {
+            return RemoveKey(k);
+        }
+
+        bool Contains(const T& k) const override {
+            return FindNode(k) != nullptr;
+        }
+        template <typename K> requires IsTransparent
+        bool Contains(const K& k) const {
+            return FindNode(k) != nullptr;
+        }
+
+        void ContainsMany(std::span<const T> keys, std::span<bool> out) const {
+            if (out.size() < keys.size()) throw std::invalid_argument("Result span is too short");
+            for (std::size_t i = 0; i < keys.size(); i++) {
+                out[i] = Contains(keys[i]);
+            }
+        }
+
+        std::vector<iterator> FindMany(std::span<const T> keys) {
+            std::vector<iterator> result;
+            result.reserve(keys.size());
+            for (const T& k : keys) result.push_back(Find(k));
+            return result;
+        }
+        std::vector<const_iterator> FindMany(std::span<const T> keys) const {
+            std::vector<const_iterator> result;
+            result.reserve(keys.size());
+            for (const T& k : keys) result.push_back(Find(k));
+            return result;
+        }
+
+        iterator Find(const T& k) {
+            PathBuffer<Node*> path;
+            Node* node = FindPath(k, path);
+            return iterator(&root, node, path);
+        }
+        const_iterator Find(const T& k) const {
+            PathBuffer<Node*> path;
+            Node* node = FindPath(k, path);
+            return const_iterator(&root, node, path);
+        }
+        template <typename K> requires IsTransparent
+        iterator Find(const K& k) {
+            PathBuffer<Node*> path;
+            Node* node = FindPath(k, path);
+            return iterator(&root, node, path);
+        }
+        template <typename K> requires IsTransparent
+        const_iterator Find(const K& k) const {
+            PathBuffer<Node*> path;
+            Node* node = FindPath(k, path);
+            return const_iterator(&root, node, path);
+        }
+
+        // Поиск по порядку
+        iterator LowerBound(const T& k) {
+            PathBuffer<Node*> path;
+            Node* node = BoundPath<false>(k, path);
+            return iterator(&root, node, path);
+        }
+        const_iterator LowerBound(const T& k) const {
+            PathBuffer<Node*> path;
+            Node* node = BoundPath<false>(k, path);
+            return const_iterator(&root, node, path);
+        }
+
+        iterator UpperBound(const T& k) {
+            PathBuffer<Node*> path;
+            Node* node = BoundPath<true>(k, path);
+            return iterator(&root, node, path);
+        }
+        const_iterator UpperBound(const T& k) const {
+            PathBuffer<Node*> path;
+            Node* node = BoundPath<true>(k, path);
+            return const_iterator(&root, node, path);
+        }
+
+        iterator Floor(const T& k) {
+            iterator it = UpperBound(k);
+            if (it == begin()) return end();
+            return --it;
+        }
+        const_iterator Floor(const T& k) const {
+            const_iterator it = UpperBound(k);
+            if (it == cbegin()) return cend();
+            return --it;
+        }
+
+        iterator Ceiling(const T& k) {
+            return LowerBound(k);
+        }
+        const_iterator Ceiling(const T& k) const {
+            return LowerBound(k);
+        }
+
+        // Обходит ключи из [lo, hi) по возрастанию за O(log n + k).
+        template <typename F>
+        void ForEachInRange(const T& lo, const T& hi, F&& visit) const {
+            for (const_iterator it = LowerBound(lo); it != cend() && Less(*it, hi); ++it) {
+                if (!VisitKey(visit, *it)) return;
+            }
+        }
+
+        // Порядковые статистики за O(log n) по размерам поддеревьев.
+        int Rank(const T& k) const {
+            int rank = 0;
+            Node* current = root;
+            while (current) {
+                if (Less(current->key, k)) {
+                    rank += SubtreeSize(current->left) + 1;
+                    current = current->right;
+                } else {
+                    current = current->left;
+                }
+            }
+            return rank;
+        }
+
+        T Select(int index) const {
+            if (index < 0 || index >= Size()) throw std::out_of_range("Index out of range");
+            Node* current = root;
+            while (true) {
+                int leftSize = SubtreeSize(current->left);
+                if (index == leftSize) return current->key;
+                if (index < leftSize) {
+                    current = current->left;
+                } else {
+                    index -= leftSize + 1;
+                    current = current->right;
+                }
+            }
+        }
+
+        int CountRange(const T& lo, const T& hi) const {
+            int count = Rank(hi) - Rank(lo);
+            return count > 0 ? count : 0;
+        }
+
+        // Операции над множествами слиянием за O(n + m) с перестройкой дерева.
+        // Ключи в обоих деревьях должны быть уникальны.
+        void UnionWith(const PersistentAVL_Tree& other) {
+            if (root == other.root || !other.root) return;
+            std::vector<T> values;
+            values.reserve(Size() + other.Size());
+            std::set_union(cbegin(), cend(), other.cbegin(), other.cend(), std::back_inserter(values), Compare{});
+            Rebuild(values);
+        }
+
+        void IntersectWith(const PersistentAVL_Tree& other) {
+            if (root == other.root) return;
+            std::vector<T> values;
+            std::set_intersection(cbegin(), cend(), other.cbegin(), other.cend(), std::back_inserter(values), Compare{});
+            Rebuild(values);
+        }
+
+        void DifferenceWith(const PersistentAVL_Tree& other) {
+            if (root == other.root) {
+                Clear();
+                return;
+            }
+            std::vector<T> values;
+            std::set_difference(cbegin(), cend(), other.cbegin(), other.cend(), std::back_inserter(values), Compare{});
+            Rebuild(values);
+        }
+
+        // Обходы. Посетитель может вернуть VisitResult::Stop, тогда обход прерывается
+        // и функция возвращает false.
+        template <typename F>
+        bool PreOrder(F&& visit) const { // КЛП
+            PathBuffer<Node*> stack;
+            if (root) stack.Push(root);
+
+            while (!stack.IsEmpty()) {
+                Node* current = stack.Top();
+                stack.Pop();
+                if (!VisitKey(visit, current->key)) return false;
+                if (current->right) stack.Push(current->right);
+                if (current->left) stack.Push(current->left);
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool ReversePreOrder(F&& visit) const { // КПЛ
+            PathBuffer<Node*> stack;
+            if (root) stack.Push(root);
+
+            while (!stack.IsEmpty()) {
+                Node* current = stack.Top();
+                stack.Pop();
+                if (!VisitKey(visit, current->key)) return false;
+                if (current->left) stack.Push(current->left);
+                if (current->right) stack.Push(current->right);
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool InOrder(F&& visit) const { // ЛКП
+            PathBuffer<Node*> stack;
+            Node* current = root;
+
+            while (current || !stack.IsEmpty()) {
+                while (current) {
+                    stack.Push(current);
+                    current = current->left;
+                }
+                current = stack.Top();
+                stack.Pop();
+                if (!VisitKey(visit, current->key)) return false;
+                current = current->right;
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool ReverseInOrder(F&& visit) const { // ПКЛ
+            PathBuffer<Node*> stack;
+            Node* current = root;
+
+            while (current || !stack.IsEmpty()) {
+                while (current) {
+                    stack.Push(current);
+                    current = current->right;
+                }
+                current = stack.Top();
+                stack.Pop();
+                if (!VisitKey(visit, current->key)) return false;
+                current = current->left;
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool PostOrder(F&& visit) const { // ЛПК
+            PathBuffer<Node*> stack;
+            Node* current = root;
+            Node* lastVisited = nullptr;
+
+            while (current || !stack.IsEmpty()) {
+                if (current) {
+                    stack.Push(current);
+                    current = current->left;
+                } else {
+                    Node* peek = stack.Top();
+                    if (peek->right && lastVisited != peek->right) {
+                        current = peek->right;
+                    } else {
+                        if (!VisitKey(visit, peek->key)) return false;
+                        lastVisited = peek;
+                        stack.Pop();
+                    }
+                }
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool ReversePostOrder(F&& visit) const { // ПЛК
+            PathBuffer<Node*> stack;
+            Node* current = root;
+            Node* lastVisited = nullptr;
+
+            while (current || !stack.IsEmpty()) {
+                if (current) {
+                    stack.Push(current);
+                    current = current->right;
+                } else {
+                    Node* peek = stack.Top();
+                    if (peek->left && lastVisited != peek->left) {
+                        current = peek->left;
+                    } else {
+                        if (!VisitKey(visit, peek->key)) return false;
+                        lastVisited = peek;
+                        stack.Pop();
+                    }
+                }
+            }
+            return true;
+        }
+
+        template <typename F>
+        bool Traverse(BypassType order, F&& visit) const {
+            switch (order) {
+                case BypassType::PreOrder : return PreOrder(visit);
+                case BypassType::ReversePreOrder : return ReversePreOrder(visit);
+                case BypassType::InOrder : return InOrder(visit);
+                case BypassType::ReverseInOrder : return ReverseInOrder(visit);
+                case BypassType::PostOrder : return PostOrder(visit);
+                case BypassType::ReversePostOrder : return ReversePostOrder(visit);
+                default:
+                    throw std::invalid_argument("Unknown Bypass type");
+            }
+        }
+
+        void PreOrder(std::function<void(const T&)> visit) const override {
+            PreOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReversePreOrder(std::function<void(const T&)> visit) const override {
+            ReversePreOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void InOrder(std::function<void(const T&)> visit) const override {
+            InOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReverseInOrder(std::function<void(const T&)> visit) const override {
+            ReverseInOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void PostOrder(std::function<void(const T&)> visit) const override {
+            PostOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        void ReversePostOrder(std::function<void(const T&)> visit) const override {
+            ReversePostOrder<std::function<void(const T&)>&>(visit);
+        }
+
+        bool Traverse(BypassType order, std::function<VisitResult(const T&)> visit) const override {
+            return Traverse<std::function<VisitResult(const T&)>&>(order, visit);
+        }
+
+        // Поддерево делится с исходным деревом, поэтому не копируется.
+        PersistentAVL_Tree* GetSubTree(const T& k) const override {
+            PersistentAVL_Tree* result = new PersistentAVL_Tree();
+            result->root = Retain(FindNode(k));
+            return result;
+        }
+
+        PersistentAVL_Tree* Concat(Tree<T>* other) const override {
+            PersistentAVL_Tree* tree = dynamic_cast<PersistentAVL_Tree*>(other);
+            if (!tree) {
+                PersistentAVL_Tree* result = new PersistentAVL_Tree(*this);
+                other->PreOrder([result](const T& value) {result->Insert(value);});
+                return result;
+            }
+            std::vector<T> values;
+            values.reserve(Size() + tree->Size());
+            std::merge(cbegin(), cend(), tree->cbegin(), tree->cend(), std::back_inserter(values), Compare{});
+            return FromSorted(values);
+        }
+
+        PersistentAVL_Tree* Clutch(Tree<T>* other) override {
+            std::vector<T> values;
+            values.reserve(other->Size());
+            other->InOrder([&values](const T& value) {values.push_back(value);});
+            for (const T& value : values) {
+                Insert(value);
+            }
+            return this;
+        }
+
+        template <typename U>
+        PersistentAVL_Tree<U, Compare>* Map(std::function<U(T)> f) const {
+            std::vector<U> values;
+            values.reserve(Size());
+            InOrder([&values, &f](const T& value) {values.push_back(f(value));});
+            std::stable_sort(values.begin(), values.end(), Compare{});
+            return PersistentAVL_Tree<U, Compare>::FromSorted(values);
+        }
+
+        PersistentAVL_Tree* Where(std::function<bool(T)> f) const {
+            std::vector<T> values;
+            InOrder([&values, &f](const T& value) {
+                if (f(value)) values.push_back(value);
+            });
+            return FromSorted(values);
+        }
+
+        // Первые limit подходящих элементов; обход останавливается на последнем из них.
+        PersistentAVL_Tree* Where(std::function<bool(T)> f, int limit) const {
+            std::vector<T> values;
+            if (limit > 0) {
+                InOrder([&values, &f, limit](const T& value) {
+                    if (f(value)) values.push_back(value);
+                    return (int)values.size() < limit ? VisitResult::Continue : VisitResult::Stop;
+                });
+            }
+            return FromSorted(values);
+        }
+
+        // Наибольший префикс (в порядке возрастания), все элементы которого удовлетворяют f.
+        PersistentAVL_Tree* TakeWhile(std::function<bool(T)> f) const {
+            std::vector<T> values;
+            InOrder([&values, &f](const T& value) {
+                if (!f(value)) return VisitResult::Stop;
+                values.push_back(value);
+                return VisitResult::Continue;
+            });
+            return FromSorted(values);
+        }
+
+        // Наименьший элемент, удовлетворяющий pred, или end().
+        template <typename F>
+        iterator FindFirst(F&& pred) {
+            iterator it = begin();
+            while (it != end() && !pred(*it)) ++it;
+            return it;
+        }
+        template <typename F>
+        const_iterator FindFirst(F&& pred) const {
+            const_iterator it = cbegin();
+            while (it != cend() && !pred(*it)) ++it;
+            return it;
+        }
+
+        // Неизменяемый снимок для чтения; повторяющиеся ключи схлопываются в один.
+        FrozenSet<T, Compare>* Freeze() const {
+            return FrozenSet<T, Compare>::FromSorted(*this);
+        }
+
+        static PersistentAVL_Tree* fromString(const std::string& data) {
+            std::vector<T> values;
+            std::istringstream iss(data);
+            char c;
+            T value;
+            if (iss >> value) {
+                values.push_back(value);
+                while (iss >> c >> value) {
+                    if (c != ',') break;
+                    values.push_back(value);
+                }
+            }
+            if (!std::is_sorted(values.begin(), values.end(), Compare{})) std::stable_sort(values.begin(), values.end(), Compare{});
+            return FromSorted(values);
+        }
+
+        std::string toString(BypassType order = BypassType::InOrder) const {
+            std::ostringstream oss;
+            Traverse(order, [&oss](const T& value) {oss << value << " ";});
+            return oss.str();
+        }
+
+        // Освобождаются только узлы, которые не входят в другие версии.
+        void Clear() override {
+            Release(root);
+            root = nullptr;
+        }
+
+        ~PersistentAVL_Tree() override {
+            Release(root);
+        }
+
+    private:
+        Node* root;
+
+        static constexpr int RebuildRatio = 4;
+
+        template <typename A, typename B>
+        static bool Less(const A& a, const B& b) {
+            return Compare{}(a, b);
+        }
+
+        static int SubtreeSize(Node* p) {
+            return p ? p->size : 0;
+        }
+
+        static unsigned Height(Node* p) {
+            return p ? p->height : 0;
+        }
+
+        static int BFactor(Node* p) {
+            return (int)Height(p->right) - (int)Height(p->left);
+        }
+
+        static void FixHeight(Node* p) {
+            unsigned hl = Height(p->left);
+            unsigned hr = Height(p->right);
+            p->height = (unsigned char)((hl > hr ? hl : hr) + 1);
+            p->size = SubtreeSize(p->left) + SubtreeSize(p->right) + 1;
+        }
+
+        static Node* Retain(Node* p) {
+            if (p) p->refs.fetch_add(1, std::memory_order_relaxed);
+            return p;
+        }
+
+        // Снимает ссылку; узел, на который больше никто не ссылается, удаляется вместе
+        // со ссылками на детей. Правая ветка разворачивается в цикл.
+        static void Release(Node* p) {
+            while (p && p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Release(p->left);
+                Node* right = p->right;
+                delete p;
+                p = right;
+            }
+        }
+
+        // Принимает ссылку на узел и возвращает узел, который можно менять: сам p,
+        // если других ссылок на него нет, иначе копию, делящую с p обоих детей.
+        static Node* Unique(Node* p) {
+            if (p->refs.load(std::memory_order_acquire) == 1) return p;
+            Node* copy = new Node(p->key);
+            copy->left = Retain(p->left);
+            copy->right = Retain(p->right);
+            copy->height = p->height;
+            copy->size = p->size;
+            Release(p);
+            return copy;
+        }
+
+        // Все функции изменения ниже забирают ссылку на переданное поддерево
+        // и возвращают ссылку на его новую версию; p в них уже принадлежит одной версии.
+        static Node* RotateRight(Node* p) {
+            Node* q = Unique(p->left);
+            p->left = q->right;
+            q->right = p;
+            FixHeight(p);
+            FixHeight(q);
+            return q;
+        }
+
+        static Node* RotateLeft(Node* q) {
+            Node* p = Unique(q->right);
+            q->right = p->left;
+            p->left = q;
+            FixHeight(q);
+            FixHeight(p);
+            return p;
+        }
+
+        static Node* Balance(Node* p) {
+            FixHeight(p);
+            if (BFactor(p) == 2) {
+                if (BFactor(p->right) < 0) p->right = RotateRight(Unique(p->right));
+                return RotateLeft(p);
+            }
+            if (BFactor(p) == -2) {
+                if (BFactor(p->left) > 0) p->left = RotateLeft(Unique(p->left));
+                return RotateRight(p);
+            }
+            return p;
+        }
+
+        // Спуск со сравнениями только читает дерево и запоминает повороты; пути копируются
+        // уже по ним, когда известно, что ключа нет.
+        template <typename K>
+        bool InsertUniqueKey(K&& k) {
+            PathBuffer<bool> toLeft;
+            for (Node* p = root; p;) {
+                int order = CompareKeys(k, p->key);
+                if (order == 0) return false;
+                toLeft.Push(order < 0);
+                p = order < 0 ? p->left : p->right;
+            }
+            root = InsertAlong(root, toLeft, 0, std::forward<K>(k));
+            return true;
+        }
+
+        template <typename K>
+        static Node* InsertAlong(Node* p, const PathBuffer<bool>& toLeft, int depth, K&& k) {
+            if (!p) return new Node(std::forward<K>(k));
+            p = Unique(p);
+            if (toLeft[depth]) p->left = InsertAlong(p->left, toLeft, depth + 1, std::forward<K>(k));
+            else p->right = InsertAlong(p->right, toLeft, depth + 1, std::forward<K>(k));
+            return Balance(p);
+        }
+
+        template <typename K>
+        static Node* InsertNode(Node* p, K&& k) {
+            if (!p) return new Node(std::forward<K>(k));
+            p = Unique(p);
+            if (Less(k, p->key)) p->left = InsertNode(p->left, std::forward<K>(k));
+            else p->right = InsertNode(p->right, std::forward<K>(k));
+            return Balance(p);
+        }
+
+        // Как и при вставке, повороты запоминаются спуском только для чтения, а пути
+        // копируются по ним, когда ключ найден.
+        template <typename K>
+        bool RemoveKey(const K& k) {
+            PathBuffer<bool> toLeft;
+            for (Node* p = root;;) {
+                if (!p) return false;
+                int order = ThreeWayCompare<Compare>(k, p->key);
+                if (order == 0) break;
+                toLeft.Push(order < 0);
+                p = order < 0 ? p->left : p->right;
+            }
+            root = RemoveAlong(root, toLeft, 0);
+            return true;
+        }
+
+        // Удаляемый узел лежит в конце пути toLeft. Узел с двумя детьми получает ключ преемника.
+        static Node* RemoveAlong(Node* p, const PathBuffer<bool>& toLeft, int depth) {
+            p = Unique(p);
+            if (depth < toLeft.GetSize()) {
+                if (toLeft[depth]) p->left = RemoveAlong(p->left, toLeft, depth + 1);
+                else p->right = RemoveAlong(p->right, toLeft, depth + 1);
+            } else {
+                if (!p->right) {
+                    Node* left = p->left;
+                    p->left = nullptr;
+                    Release(p);
+                    return left;
+                }
+                p->right = RemoveMin(p->right, p->key);
+            }
+            return Balance(p);
+        }
+
+        static Node* RemoveMin(Node* p, T& key) {
+            p = Unique(p);
+            if (!p->left) {
+                key = std::move(p->key);
+                Node* right = p->right;
+                p->right = nullptr;
+                Release(p);
+                return right;
+            }
+            p->left = RemoveMin(p->left, key);
+            return Balance(p);
+        }
+
+        template <typename K>
+        Node* FindNode(const K& k) const {
+            Node* current = root;
+            while (current) {
+                int order = ThreeWayCompare<Compare>(k, current->key);
+                if (order == 0) return current;
+                current = order < 0 ? current->left : current->right;
+            }
+            return nullptr;
+        }
+
+        template <typename K>
+        Node* FindPath(const K& k, PathBuffer<Node*>& path) const {
+            Node* current = root;
+            while (current) {
+                int order = ThreeWayCompare<Compare>(k, current->key);
+                if (order == 0) return current;
+                path.Push(current);
+                current = order < 0 ? current->left : current->right;
+            }
+            return nullptr;
+        }
+
+        // Первый ключ, не меньший k (Upper == false) или больший k (Upper == true);
+        // в path остаётся путь до него.
+        template <bool Upper, typename K>
+        Node* BoundPath(const K& k, PathBuffer<Node*>& path) const {
+            Node* current = root;
+            Node* result = nullptr;
+            int depth = 0;
+            while (current) {
+                bool toRight = Upper ? !Less(k, current->key) : Less(current->key, k);
+                if (!toRight) {
+                    result = current;
+                    depth = path.GetSize();
+                }
+                path.Push(current);
+                current = toRight ? current->right : current->left;
+            }
+            while (path.GetSize() > depth) path.Pop();
+            return result;
+        }
+
+        Node* MinPath(PathBuffer<Node*>& path) const {
+            Node* current = root;
+            if (!current) return nullptr;
+            while (current->left) {
+                path.Push(current);
+                current = current->left;
+            }
+            return current;
+        }
+
+        template <typename It>
+        static Node* BuildSorted(It& it, int count) {
+            if (count <= 0) return nullptr;
+            Node* left = BuildSorted(it, count / 2);
+            Node* node = new Node(*it);
+            ++it;
+            node->left = left;
+            node->right = BuildSorted(it, count - count / 2 - 1);
+            FixHeight(node);
+            return node;
+        }
+
+        void Rebuild(const std::vector<T>& values) {
+            Release(root);
+            auto it = values.cbegin();
+            root = BuildSorted(it, (int)values.size());
+        }
+
+        void MergeBatch(std::vector<T>& batch, bool unique) {
+            if (!std::is_sorted(batch.begin(), batch.end(), Compare{})) std::stable_sort(batch.begin(), batch.end(), Compare{});
+            if (unique) {
+                batch.erase(std::unique(batch.begin(), batch.end(), [](const T& a, const T& b) {return CompareKeys(a, b) == 0;}), batch.end());
+            }
+            if (batch.empty()) return;
+            if ((long long)batch.size() * RebuildRatio >= Size()) {
+                std::vector<T> values;
+                values.reserve(Size() + batch.size());
+                if (unique) std::set_union(cbegin(), cend(), batch.begin(), batch.end(), std::back_inserter(values), Compare{});
+                else std::merge(cbegin(), cend(), batch.begin(), batch.end(), std::back_inserter(values), Compare{});
+                Rebuild(values);
+                return;
+            }
+            for (const T& value : batch) {
+                if (unique) InsertUnique(value);
+                else Insert(value);
+            }
+        }
+};
+
+#endif // PERSISTENTAVL_HPP
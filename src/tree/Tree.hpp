@@ -3,6 +3,21 @@
 
 #include <functional>
 
+enum class BypassType {
+    PreOrder,
+    ReversePreOrder,
+    InOrder,
+    ReverseInOrder,
+    PostOrder,
+    ReversePostOrder
+};
+
+// Ответ посетителя: Stop прерывает обход.
+enum class VisitResult {
+    Continue,
+    Stop
+};
+
 template <typename T>
 class Tree {
     public:
@@ -16,6 +31,8 @@ class Tree {
         virtual void ReverseInOrder(std::function<void(const T&)> visit) const = 0;
         virtual void PostOrder(std::function<void(const T&)> visit) const = 0;
         virtual void ReversePostOrder(std::function<void(const T&)> visit) const = 0;
+        // Возвращает false, если посетитель остановил обход.
+        virtual bool Traverse(BypassType order, std::function<VisitResult(const T&)> visit) const = 0;
         virtual Tree<T>* GetSubTree(const T& k) const = 0;
         virtual Tree<T>* Concat(Tree<T>* other) const = 0;
         virtual Tree<T>* Clutch(Tree<T>* other) = 0;
@@ -0,0 +1,87 @@
+#ifndef TREEHELPERS_HPP
+#define TREEHELPERS_HPP
+
+#include <compare>
+#include <concepts>
+#include <functional>
+#include <type_traits>
+#include "Tree.hpp"
+
+// Общие для деревьев поиска сравнение ключей и вызов посетителя.
+
+template <typename Compare>
+inline constexpr bool IsTransparentCompare = requires { typename Compare::is_transparent; };
+
+// Трёхстороннее сравнение: отрицательное, если a предшествует b, и 0 для эквивалентных ключей.
+// Для std::less<> это один вызов <=>, а если его нет, то == и <. Compare может предоставить
+// собственное статическое ThreeWay(a, b), например обёртка, сравнивающая части составного ключа.
+template <typename Compare, typename A, typename B>
+int ThreeWayCompare(const A& a, const B& b) {
+    if constexpr (requires { { Compare::ThreeWay(a, b) } -> std::convertible_to<int>; }) {
+        return Compare::ThreeWay(a, b);
+    } else if constexpr (std::is_same_v<Compare, std::less<>> && std::three_way_comparable_with<A, B>) {
+        auto order = a <=> b;
+        return order < 0 ? -1 : (order > 0 ? 1 : 0);
+    } else if constexpr (std::is_same_v<Compare, std::less<>>) {
+        return a == b ? 0 : (a < b ? -1 : 1);
+    } else {
+        Compare compare;
+        return compare(a, b) ? -1 : (compare(b, a) ? 1 : 0);
+    }
+}
+
+// Порядок записей (MultiSet, Map) по их полю key. Прозрачен, так что записи ищутся
+// по самому ключу, и сравнивает ключи одним трёхсторонним сравнением.
+template <typename Entry, typename Compare>
+struct EntryKeyCompare {
+    using is_transparent = void;
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        return Compare{}(KeyOf(a), KeyOf(b));
+    }
+
+    template <typename A, typename B>
+    static int ThreeWay(const A& a, const B& b) {
+        return ThreeWayCompare<Compare>(KeyOf(a), KeyOf(b));
+    }
+
+    template <typename K>
+    static const K& KeyOf(const K& k) {
+        return k;
+    }
+
+    static const auto& KeyOf(const Entry& entry) {
+        return entry.key;
+    }
+};
+
+// Посетитель обхода может вернуть void или VisitResult; false означает остановку.
+template <typename F, typename K>
+bool VisitKey(F& visit, const K& key) {
+    if constexpr (std::is_same_v<std::invoke_result_t<F&, const K&>, VisitResult>) {
+        return visit(key) == VisitResult::Continue;
+    } else {
+        visit(key);
+        return true;
+    }
+}
+
+// Симметричный обход узлов поддерева p с порядковыми номерами из [first, last), где offset -
+// номер самого левого узла поддерева. Узлы должны хранить размеры поддеревьев; O(log n + last - first).
+template <typename NodeType, typename F>
+void VisitRankRange(NodeType* p, int offset, int first, int last, F& visit) {
+    while (p) {
+        int rank = offset + (p->left ? p->left->size : 0);
+        if (first < rank) VisitRankRange(p->left, offset, first, last, visit);
+        if (rank >= last) return;
+        // Узлы, удалённые лениво (AVL_Tree::SetLazyRemove), не занимают ранга.
+        int live = 1;
+        if constexpr (requires { p->dead; }) live = !p->dead;
+        if (rank >= first && live) visit(p);
+        offset = rank + live;
+        p = p->right;
+    }
+}
+
+#endif // TREEHELPERS_HPP